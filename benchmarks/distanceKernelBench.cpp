@@ -0,0 +1,140 @@
+// Microbenchmark of the distance constraint kernel. Builds the constraint
+// topology addRope and addDynamicObjectAsSoftBody produce, a chain and a
+// cloth with structural and shear edges, colors it like the solver does and
+// times every instruction set the cpu supports against the scalar path.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "dynamics/particleData.h"
+#include "dynamics/constraintBatch.h"
+#include "dynamics/constraintColoring.h"
+#include "dynamics/distanceKernel.h"
+
+struct Setup
+{
+    const char *name;
+    ParticleData particles;
+    DistanceConstraintBatch batch;
+    ConstraintColoring coloring;
+};
+
+static float jitter()
+{
+    return 0.2f * (float(rand()) / RAND_MAX - 0.5f);
+}
+
+static void addEdge(Setup &_s, int _a, int _b)
+{
+    float d = (_s.particles.x[_a] - _s.particles.x[_b]).length();
+    _s.batch.add(_a, _b, d);
+}
+
+static void buildRope(Setup &_s, int _numParticles)
+{
+    _s.name = "rope";
+    for(int i=0; i < _numParticles; i++)
+        _s.particles.add(QVector3D(-0.75f * i, 6, 0), 1.0);
+    for(int i=1; i < _numParticles; i++)
+        addEdge(_s, i - 1, i);
+}
+
+static void buildCloth(Setup &_s, int _width)
+{
+    _s.name = "cloth";
+    for(int j=0; j < _width; j++)
+        for(int i=0; i < _width; i++)
+            _s.particles.add(QVector3D(0.5f * i, 6, 0.5f * j), 1.0);
+
+    for(int j=0; j < _width; j++)
+    {
+        for(int i=0; i < _width; i++)
+        {
+            int idx = j * _width + i;
+            if(i + 1 < _width)
+                addEdge(_s, idx, idx + 1);
+            if(j + 1 < _width)
+                addEdge(_s, idx, idx + _width);
+            if(i + 1 < _width && j + 1 < _width)
+            {
+                addEdge(_s, idx, idx + _width + 1);
+                addEdge(_s, idx + 1, idx + _width);
+            }
+        }
+    }
+}
+
+static void prepare(Setup &_s)
+{
+    _s.coloring.reset(int(_s.particles.size()));
+    for(int i=0; i < int(_s.batch.size()); i++)
+        _s.coloring.add(i, _s.batch.p1[i], _s.batch.p2[i]);
+
+    for(size_t i=0; i < _s.particles.size(); i++)
+        _s.particles.p[i] = _s.particles.x[i] + QVector3D(jitter(), jitter(), jitter());
+}
+
+static double run(Setup &_s, const AlignedVector<QVector3D> &_start, int _iterations)
+{
+    _s.particles.p = _start;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for(int it=0; it < _iterations; it++)
+    {
+        for(int c=0; c < _s.coloring.numColors(); c++)
+        {
+            const std::vector<int> &color = _s.coloring.color(c);
+            DistanceKernel::project(_s.batch, _s.particles, color.data(), int(color.size()));
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+static void bench(Setup &_s, int _iterations)
+{
+    prepare(_s);
+    AlignedVector<QVector3D> start = _s.particles.p;
+
+    DistanceKernel::setIsa(DistanceKernel::SCALAR);
+    double scalarMs = run(_s, start, _iterations);
+    AlignedVector<QVector3D> reference = _s.particles.p;
+
+    printf("%-6s %8zu constraints %3d colors  scalar %9.2f ms\n",
+           _s.name, _s.batch.size(), _s.coloring.numColors(), scalarMs);
+
+    for(int isa = DistanceKernel::SSE; isa <= DistanceKernel::detectIsa(); isa++)
+    {
+        DistanceKernel::setIsa(DistanceKernel::Isa(isa));
+        double ms = run(_s, start, _iterations);
+
+        float maxDiff = 0;
+        for(size_t i=0; i < reference.size(); i++)
+            maxDiff = std::max(maxDiff, (reference[i] - _s.particles.p[i]).length());
+
+        printf("%-6s %8zu constraints %3d colors  %-6s %9.2f ms  %5.2fx  max diff %g\n",
+               _s.name, _s.batch.size(), _s.coloring.numColors(),
+               DistanceKernel::isaName(DistanceKernel::Isa(isa)), ms, scalarMs / ms, maxDiff);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 50;
+    int size = argc > 2 ? atoi(argv[2]) : 512;
+
+    srand(1);
+    printf("iterations %d, detected %s\n", iterations, DistanceKernel::isaName(DistanceKernel::detectIsa()));
+
+    Setup rope;
+    buildRope(rope, size * size);
+    bench(rope, iterations);
+
+    Setup cloth;
+    buildCloth(cloth, size);
+    bench(cloth, iterations);
+
+    return 0;
+}
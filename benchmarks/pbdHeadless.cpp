@@ -0,0 +1,272 @@
+// Headless simulation runner. Loads a scene description, steps the dynamics
+// world for a number of frames without a window or OpenGL context and
+// reports how long every phase of DynamicsWorld::update() took.
+//
+//   pbdHeadless <scene file> [frames]
+//
+// Scene files hold one command per line, '#' starts a comment:
+//
+//   frames 300                         frames to step, the command line wins
+//   dt 0.02                            time step size
+//   iterations 10                      solver iterations
+//   substeps 1                         substeps of one iteration each
+//   preconditions 2                    preconditioning iterations
+//   solver gauss-seidel | jacobi [w]   solver and Jacobi over-relaxation
+//   shapematching svd | quaternion     rotation extraction of shape matching
+//   compliance distance | shapematching | bending a   XPBD compliance, 0 is rigid
+//   sleeping on | off                  islands at rest fall asleep
+//   plane nx ny nz  ox oy oz           collision plane besides the ground
+//   mesh x y z  nx nz  spacing  bump   static triangle mesh, a height field
+//                                      of nx by nz quads with wavy bumps
+//   pile x y z  nx ny nz  spacing      grid of free particles
+//   box x y z  nx ny nz  spacing       rigid body, a shape matched particle grid
+//   rope x0 y0 z0  x1 y1 z1  segments  particle chain
+//   pin                                pins the first particle of the last rope
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <QElapsedTimer>
+
+#include <omp.h>
+
+#include "dynamics/dynamicsWorld.h"
+
+static QVector3D readVector(std::istringstream &_in)
+{
+    float x = 0, y = 0, z = 0;
+    _in >> x >> y >> z;
+    return QVector3D(x, y, z);
+}
+
+static std::vector<QVector3D> gridPoints(const QVector3D &_size, float _spacing)
+{
+    std::vector<QVector3D> points;
+    int nx = int(_size.x()), ny = int(_size.y()), nz = int(_size.z());
+    QVector3D center = 0.5f * _spacing * QVector3D(nx - 1, ny - 1, nz - 1);
+    for(int k=0; k < ny; k++)
+        for(int j=0; j < nz; j++)
+            for(int i=0; i < nx; i++)
+                points.push_back(_spacing * QVector3D(i, k, j) - center);
+    return points;
+}
+
+// two triangles per quad, centered on _pos
+static void heightField(const QVector3D &_pos, int _nx, int _nz, float _spacing, float _bump,
+                        std::vector<QVector3D> &_vertices, std::vector<unsigned int> &_indices)
+{
+    QVector3D center = 0.5f * _spacing * QVector3D(_nx, 0, _nz);
+    for(int j=0; j <= _nz; j++)
+        for(int i=0; i <= _nx; i++)
+        {
+            float y = _bump * std::sin(0.3f * i) * std::cos(0.2f * j);
+            _vertices.push_back(_pos + QVector3D(_spacing * i, y, _spacing * j) - center);
+        }
+
+    for(int j=0; j < _nz; j++)
+        for(int i=0; i < _nx; i++)
+        {
+            unsigned int a = j * (_nx + 1) + i;
+            unsigned int b = a + 1;
+            unsigned int c = a + _nx + 1;
+            unsigned int d = c + 1;
+            unsigned int quad[6] = {a, c, b, b, c, d};
+            _indices.insert(_indices.end(), quad, quad + 6);
+        }
+}
+
+static bool loadScene(const char *_path, DynamicsWorld &_world, int &_frames)
+{
+    std::ifstream file(_path);
+    if(!file)
+    {
+        fprintf(stderr, "could not open scene %s\n", _path);
+        return false;
+    }
+
+    int ropeStart = -1;
+    int lineNumber = 0;
+    std::string line;
+    while(std::getline(file, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string cmd;
+        if(!(in >> cmd))
+            continue;
+
+        if(cmd == "frames")
+            in >> _frames;
+        else if(cmd == "dt")
+            in >> _world.m_dt;
+        else if(cmd == "iterations")
+            in >> _world.m_constraintIteration;
+        else if(cmd == "substeps")
+            in >> _world.m_substeps;
+        else if(cmd == "preconditions")
+            in >> _world.m_preConditionIteration;
+        else if(cmd == "solver")
+        {
+            std::string type;
+            in >> type;
+            _world.m_solverType = type == "jacobi" ? DynamicsWorld::JACOBI : DynamicsWorld::GAUSS_SEIDEL;
+            in >> _world.m_overRelaxation;
+        }
+        else if(cmd == "shapematching")
+        {
+            std::string method;
+            in >> method;
+            _world.setShapeMatchingRotationMethod(method == "svd" ? ShapeMatchingConstraint::SVD
+                                                                  : ShapeMatchingConstraint::QUATERNION);
+        }
+        else if(cmd == "compliance")
+        {
+            std::string type;
+            float compliance = 0;
+            in >> type >> compliance;
+            if(type == "shapematching")
+                _world.setAllShapeMatchingCompliance(compliance);
+            else if(type == "bending")
+                _world.setAllBendingCompliance(compliance);
+            else
+                _world.setAllDistanceConstraintCompliance(compliance);
+        }
+        else if(cmd == "sleeping")
+        {
+            std::string mode;
+            in >> mode;
+            _world.setSleeping(mode != "off");
+        }
+        else if(cmd == "plane")
+        {
+            Plane plane;
+            plane.Normal = readVector(in).normalized();
+            plane.Offset = readVector(in);
+            _world.addPlane(plane);
+        }
+        else if(cmd == "mesh")
+        {
+            QVector3D pos = readVector(in);
+            int nx = 1, nz = 1;
+            float spacing = 1, bump = 0;
+            in >> nx >> nz >> spacing >> bump;
+            std::vector<QVector3D> vertices;
+            std::vector<unsigned int> indices;
+            heightField(pos, nx, nz, spacing, bump, vertices, indices);
+            _world.addTriangleMesh(vertices, indices);
+        }
+        else if(cmd == "pile")
+        {
+            QVector3D pos = readVector(in);
+            QVector3D size = readVector(in);
+            float spacing = 1;
+            in >> spacing;
+            // every particle is a body of its own, so they all collide
+            for(const QVector3D &p : gridPoints(size, spacing))
+                _world.addParticle(pos + p, ++_world.objectCount);
+        }
+        else if(cmd == "box")
+        {
+            QVector3D pos = readVector(in);
+            QVector3D size = readVector(in);
+            float spacing = 1;
+            in >> spacing;
+            QMatrix4x4 transform;
+            transform.translate(pos);
+            _world.addRigidBodyGrid(gridPoints(size, spacing), std::vector<QVector3D>(), transform);
+        }
+        else if(cmd == "rope")
+        {
+            QVector3D start = readVector(in);
+            QVector3D end = readVector(in);
+            int segments = 1;
+            in >> segments;
+            ropeStart = int(_world.m_Particles.size());
+            _world.addRope(start, end, segments);
+        }
+        else if(cmd == "pin")
+        {
+            if(ropeStart < 0)
+            {
+                fprintf(stderr, "%s:%d: pin without a rope\n", _path, lineNumber);
+                return false;
+            }
+            ParticlePtr p = _world.m_Particles[ropeStart];
+            _world.addPinConstraint(p, p->x());
+        }
+        else
+        {
+            fprintf(stderr, "%s:%d: unknown command '%s'\n", _path, lineNumber, cmd.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static void printPhase(const char *_name, double _ms, double _total, int _frames)
+{
+    printf("  %-16s %10.3f ms %8.4f ms/frame %6.1f %%\n",
+           _name, _ms, _ms / _frames, _total > 0 ? 100.0 * _ms / _total : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <scene file> [frames]\n", argv[0]);
+        return 1;
+    }
+
+    DynamicsWorld world;
+    world.initialize();
+
+    int frames = 300;
+    if(!loadScene(argv[1], world, frames))
+        return 1;
+    if(argc > 2)
+        frames = atoi(argv[2]);
+    if(frames < 1)
+        frames = 1;
+
+    printf("scene %s: %zu particles, %zu distance, %zu shape matching constraints, %d triangles\n",
+           argv[1], world.m_particleData.size(), world.m_DistanceConstraints.size(),
+           world.m_ShapeMatchingConstraints.size(), world.m_triangleMeshes.size());
+    printf("%d threads, %s distance kernel, %d frames\n",
+           omp_get_max_threads(), DistanceKernel::isaName(DistanceKernel::isa()), frames);
+
+    PhaseTimings sum;
+    QElapsedTimer timer;
+    timer.start();
+
+    world.setSimulate(true);
+    for(int f=0; f < frames; f++)
+    {
+        world.update();
+        const PhaseTimings &t = world.timings();
+        sum.integration += t.integration;
+        sum.damping += t.damping;
+        sum.broadPhase += t.broadPhase;
+        sum.preConditioning += t.preConditioning;
+        sum.solve += t.solve;
+        sum.velocityUpdate += t.velocityUpdate;
+    }
+    double wall = double(timer.nsecsElapsed()) * 1e-6;
+
+    double total = sum.total();
+    printPhase("integration", sum.integration, total, frames);
+    printPhase("damping", sum.damping, total, frames);
+    printPhase("broad phase", sum.broadPhase, total, frames);
+    printPhase("preconditioning", sum.preConditioning, total, frames);
+    printPhase("solve", sum.solve, total, frames);
+    printPhase("velocity update", sum.velocityUpdate, total, frames);
+    printPhase("total", total, total, frames);
+    printf("  %-16s %10.3f ms\n", "wall clock", wall);
+    printf("%d of %zu particles asleep\n", world.m_islands.numAsleep(), world.m_particleData.size());
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Microbenchmark of the rotation extraction in shape matching. Builds the
+// 48 brick wall of Scene::setupScene as RigidBodyGrids of 216 particles,
+// tumbles every brick a little each frame with some noise on the particles
+// and runs matchShape() as often as the solver would, once with the SVD and
+// once with the warm started quaternion method.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "dynamics/particle.h"
+#include "dynamics/particleData.h"
+#include "dynamics/rigidBodyGrid.h"
+#include "dynamics/constraint.h"
+
+struct Wall
+{
+    ParticleData particles;
+    std::vector<std::shared_ptr<Particle>> particlePtrs;
+    std::vector<std::shared_ptr<RigidBodyGrid>> bricks;
+    std::vector<std::shared_ptr<ShapeMatchingConstraint>> constraints;
+    std::vector<QVector3D> rest;
+    std::vector<QVector3D> center;
+};
+
+static const int rows = 6;
+static const int columns = 8;
+static const int brickX = 12, brickY = 6, brickZ = 3;
+static const float spacing = 0.3f;
+
+static void buildWall(Wall &_w)
+{
+    QVector3D half = 0.5f * spacing * QVector3D(brickX - 1, brickY - 1, brickZ - 1);
+    for(int k=0; k < brickY; k++)
+        for(int j=0; j < brickZ; j++)
+            for(int i=0; i < brickX; i++)
+                _w.rest.push_back(spacing * QVector3D(i, k, j) - half);
+
+    for(int i=0; i < rows; i++)
+    {
+        for(int j=0; j < columns; j++)
+        {
+            QVector3D c(1 + 3.8f * j + (i % 2) * 2.0f, 1.15f + 1.6f * i, 0);
+            auto brick = std::make_shared<RigidBodyGrid>();
+            for(const QVector3D &r : _w.rest)
+            {
+                auto p = std::make_shared<Particle>(&_w.particles, _w.particles.add(c + r, 1.0));
+                _w.particlePtrs.push_back(p);
+                brick->addParticle(r, p);
+            }
+            _w.bricks.push_back(brick);
+            _w.center.push_back(c);
+            _w.constraints.push_back(std::make_shared<ShapeMatchingConstraint>(brick.get()));
+        }
+    }
+}
+
+static float noise(unsigned int _seed)
+{
+    _seed = (_seed ^ 61) ^ (_seed >> 16);
+    _seed *= 9;
+    _seed = _seed ^ (_seed >> 4);
+    _seed *= 0x27d4eb2d;
+    _seed = _seed ^ (_seed >> 15);
+    return 0.02f * (float(_seed & 0xffff) / 0xffff - 0.5f);
+}
+
+// every brick spins about its own axis, a little faster in each column
+static void pose(Wall &_w, int _frame)
+{
+    int n = int(_w.rest.size());
+    for(int b=0; b < int(_w.bricks.size()); b++)
+    {
+        Eigen::Vector3f axis(float(b % 3) - 1.0f, 1.0f, float(b % 5) * 0.25f);
+        Eigen::Matrix3f rot = Eigen::AngleAxisf(0.01f * _frame * (1 + b % columns), axis.normalized()).toRotationMatrix();
+        for(int i=0; i < n; i++)
+        {
+            const QVector3D &r = _w.rest[i];
+            Eigen::Vector3f x = rot * Eigen::Vector3f(r.x(), r.y(), r.z());
+            unsigned int seed = unsigned(((_frame * 48 + b) * n + i) * 3);
+            _w.particles.p[b * n + i] = _w.center[b] + QVector3D(x.x() + noise(seed), x.y() + noise(seed + 1), x.z() + noise(seed + 2));
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+    Wall walls[2];
+    const ShapeMatchingConstraint::RotationMethod methods[2] = { ShapeMatchingConstraint::SVD, ShapeMatchingConstraint::QUATERNION };
+    const char *names[2] = { "svd", "quaternion" };
+    double ms[2] = { 0, 0 };
+    std::vector<Eigen::Matrix3f> reference;
+    float maxAngle = 0;
+
+    for(int m=0; m < 2; m++)
+    {
+        Wall &w = walls[m];
+        buildWall(w);
+        for(auto &c : w.constraints)
+            c->setRotationMethod(methods[m]);
+
+        for(int f=0; f < frames; f++)
+        {
+            pose(w, f);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for(int it=0; it < iterations; it++)
+                for(auto &c : w.constraints)
+                    c->matchShape();
+            ms[m] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            // angle between the rotations of both methods
+            for(int b=0; b < int(w.constraints.size()); b++)
+            {
+                const Eigen::Matrix3f &R = w.constraints[b]->rotation();
+                if(m == 0)
+                {
+                    reference.push_back(R);
+                    continue;
+                }
+                // the skew part of the relative rotation, acos of the trace
+                // is too coarse in float for small angles
+                Eigen::Matrix3f d = reference[f * w.constraints.size() + b].transpose() * R;
+                Eigen::Vector3f axis(d(2,1) - d(1,2), d(0,2) - d(2,0), d(1,0) - d(0,1));
+                maxAngle = std::max(maxAngle, std::asin(std::min(1.0f, 0.5f * axis.norm())));
+            }
+        }
+    }
+
+    int calls = frames * iterations * int(walls[0].constraints.size());
+    printf("%zu bricks of %zu particles, %d frames x %d iterations\n",
+           walls[0].constraints.size(), walls[0].rest.size(), frames, iterations);
+    for(int m=0; m < 2; m++)
+    {
+        printf("%-12s %9.3f ms  %7.3f us/matchShape  %5.2fx\n",
+               names[m], ms[m], 1000.0 * ms[m] / calls, ms[0] / ms[m]);
+    }
+    printf("max rotation difference %g rad\n", maxAngle);
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include <QGridLayout>
 #include <QVBoxLayout>
 #include <QLabel>
+#include <QComboBox>
 #include <QLineEdit>
 #include <QSpacerItem>
 //#include <Q>
@@ -194,10 +195,24 @@ private:
     ValueSliderI *preConditionsIterEdit;
     QLabel *constraintIterLabel;
     ValueSliderI *constraintIterEdit;
+    QLabel *substepsLabel;
+    ValueSliderI *substepsEdit;
 
     QLabel *pbdDampingLabel;
     ValueSliderF *pbdDampingEdit;
 
+    QLabel *distanceComplianceLabel;
+    ValueSliderF *distanceComplianceEdit;
+    QLabel *shapeMatchingComplianceLabel;
+    ValueSliderF *shapeMatchingComplianceEdit;
+    QLabel *bendingComplianceLabel;
+    ValueSliderF *bendingComplianceEdit;
+
+    QLabel *solverLabel;
+    QComboBox *solverEdit;
+    QLabel *overRelaxationLabel;
+    ValueSliderF *overRelaxationEdit;
+
     QLabel *constraintHeadline;
 
     QLabel *distanceConstraintStretchLabel;
@@ -66,7 +66,6 @@ protected:
 
 private:
   bool m_simulating;
-  double lag;
   float fpsRate, fpsCount;
   double previous, current, elapsed, second, render;
 
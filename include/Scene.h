@@ -31,10 +31,11 @@
 #include "utils.h"
 #include "manipulator.h"
 #include "dynamics/dynamicsWorld.h"
+#include "dynamics/dynamicsThread.h"
 #include "dynamics/collisiondetection.h"
 #include "Framebuffer.h"
 
-class Scene : public AbstractScene
+class Scene : public AbstractScene, public DynamicsWorldListener
 {
   static int numCreation;
 public:
@@ -62,7 +63,11 @@ public:
   ModelPtr addModel(Scene *_scene, std::string _name, std::string _path);
 
   pSceneOb addSceneObjectFromModel(std::string _name, uint _materialID, const QVector3D &_pos, const QQuaternion &_rot);
-  pSceneOb addSceneObjectFromParticle(const DynamicObjectPtr _particle, ParticlePtr _p, int matID = 0);
+  pSceneOb addSceneObjectFromParticle(const DynamicObjectPtr _particle, ParticlePtr _p, float _radius, int matID = 0);
+  // posts the body to the world, it is built before the next step
+  void addRigidBodyGridCommand(pSceneOb _sceneObject, const std::string &_path, int _color = 0);
+  void addSdfRigidBodyGridCommand(pSceneOb _sceneObject, float _spacing, int _color = 0);
+  void particleAdded(const DynamicObjectPtr _object, ParticlePtr _particle, float _radius, int _color);
 
   LightPtr addPointLight();
   LightPtr addPointLight(const QVector3D &_pos, const QVector3D &_color);
@@ -84,6 +89,7 @@ public:
   pSceneOb getPointerFromSceneObject(const SceneObject *_sceneObject);
 
   DynamicsWorld* dynamicsWorld();
+  DynamicsThread* dynamicsThread();
 
   Ray castRayFromCamera(float ndcX, float ndcY, float depthZ  = -1.0);
   pSceneOb pickObject(float ndcX, float ndcY);
@@ -101,6 +107,7 @@ private:
   friend class Manipulator;
 
   DynamicsWorld *m_DynamicsWorld;
+  DynamicsThread *m_DynamicsThread = nullptr;
 
   QOpenGLShaderProgram* m_activeProgram;
   QOpenGLShaderProgram* m_screen_program;
@@ -131,6 +138,8 @@ private:
 
   ShapeMap m_ShapePool;
   ModelMap m_ModelPool;
+  // meshes handed to the simulation thread, one per model
+  std::map<ModelPtr, DynamicsWorld::ModelMeshPtr> m_modelMeshes;
 
   Manipulator* mainpulator;
   Framebuffer* framebuffer;
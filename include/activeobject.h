@@ -57,6 +57,7 @@ public:
     void addParticleToSelection(const ParticlePtr _p);
     void addPinTogetherConstraintToSelection();
     void deletePinTogetherConstraintFromSelection();
+    int activeParticleKey();
 
 signals:
     void transformChanged(const QMatrix4x4 _modelMat, const QVector3D num, const QVector3D num1, const QVector3D num2, int var=0);
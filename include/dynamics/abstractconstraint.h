@@ -8,6 +8,7 @@
 #include <QVector3D>
 
 #include "utils.h"
+#include "dynamics/slotMap.h"
 
 class Particle;
 
@@ -41,6 +42,8 @@ public:
     bool m_dirty = true;
     ConstraintType m_type;
     std::vector<ParticleWeakPtr> m_Particles;
+    // where the world keeps the constraint, stale once it is deleted
+    SlotHandle m_handle;
 
 };
 
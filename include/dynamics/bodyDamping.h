@@ -0,0 +1,45 @@
+#ifndef BODYDAMPING_H
+#define BODYDAMPING_H
+
+#include <cstdint>
+
+#include "dynamics/dynamicUtils.h"
+#include "dynamics/particleData.h"
+
+// PBD velocity damping (Müller et al. 2007, 3.5) of whole bodies. Damps the
+// velocities of a body towards its rigid motion, vcm + w x ri, which leaves
+// its linear and angular momentum alone. Bodies are particle ranges, or index
+// lists if their particles are scattered. Momentum and inertia are summed
+// with SIMD reductions and the bodies are damped in parallel. A body whose
+// particles were all put to sleep by the last velocity update moves as one
+// and is skipped.
+class BodyDamping
+{
+public:
+    // below this many particles the threads cost more than they gain
+    static const int minParallelWork = 4096;
+
+    BodyDamping();
+
+    void clear();
+    void addBody(const int *_indices, int _count);
+    int numBodies() const;
+
+    void damp(ParticleData &_particles, float _damping);
+    void updateSleeping(const ParticleData &_particles);
+    bool sleeping(int _body) const;
+
+private:
+    // first index of a contiguous body, -1 if it uses m_indices
+    AlignedVector<int> m_first;
+    AlignedVector<int> m_offset;
+    AlignedVector<int> m_count;
+    AlignedVector<int> m_indices;
+    AlignedVector<uint8_t> m_sleeping;
+    int m_numParticles = 0;
+};
+
+inline int BodyDamping::numBodies() const { return int(m_count.size()); };
+inline bool BodyDamping::sleeping(int _body) const { return m_sleeping[_body] != 0; };
+
+#endif // BODYDAMPING_H
@@ -0,0 +1,56 @@
+#ifndef BODYSCHEDULER_H
+#define BODYSCHEDULER_H
+
+#include <vector>
+
+#include "dynamics/constraintColoring.h"
+
+// Hands whole bodies to the threads. The shape matching constraints of one
+// color share no particles, so any thread may project any of them. Within a
+// color they are sorted by their particle count, the big bodies start first
+// and the threads pick up the small ones as they become free.
+class BodyScheduler
+{
+public:
+    // below this many particles per color the threads cost more than they gain
+    static const int minParallelWork = 2048;
+
+    BodyScheduler();
+
+    void build(const ConstraintColoring &_coloring, const std::vector<int> &_cost);
+
+    template<typename Project>
+    void project(Project _project) const;
+
+private:
+    struct Batch
+    {
+        std::vector<int> items;
+        int work;
+    };
+
+    std::vector<Batch> m_batches;
+    std::vector<int> m_sequential;
+};
+
+// calls _project(constraintIndex) for every constraint, one color at a time
+template<typename Project>
+void BodyScheduler::project(Project _project) const
+{
+    for(const Batch &b : m_batches)
+    {
+        int n = int(b.items.size());
+        #pragma omp parallel for schedule(dynamic, 1) if(n > 1 && b.work >= minParallelWork)
+        for(int i=0; i < n; i++)
+        {
+            _project(b.items[i]);
+        }
+    }
+
+    for(int i : m_sequential)
+    {
+        _project(i);
+    }
+}
+
+#endif // BODYSCHEDULER_H
@@ -12,6 +12,23 @@ typedef QVector3D Vec3;
 
 class Scene;
 
+// contact found by the pair search, turned into constraints afterwards
+struct ParticleContact
+{
+    enum Type{
+        PARTICLE,       // b is a particle index
+        COLLIDER,       // b indexes the non uniform particles
+        PLANE,          // b indexes the worlds planes
+        TRIANGLE,       // b indexes the static triangle meshes
+        SDF             // b indexes the signed distance field colliders
+    };
+
+    Type type;
+    int a, b;
+    QVector3D qc;       // entry point into a plane
+    QVector3D n;        // normal pushing out of a triangle or field
+};
+
 class CollisionDetection
 {
 public:
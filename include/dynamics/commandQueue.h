@@ -0,0 +1,85 @@
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Lock-free queue of many producers and a single consumer (Vyukov). push()
+// is one atomic exchange and never waits, pop() only runs on the consumer
+// thread. A push that is halfway through hides the ones after it until it
+// completes, pop() then reports empty and they are picked up next time.
+template <typename T>
+class CommandQueue
+{
+public:
+    CommandQueue();
+    ~CommandQueue();
+
+    void push(const T &_value);
+    bool pop(T &_value);
+    bool empty() const;
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    CommandQueue(const CommandQueue &) = delete;
+    CommandQueue& operator=(const CommandQueue &) = delete;
+
+    // producers append at the head, the consumer takes from the tail. The
+    // tail is always a spent node whose next is the first value.
+    std::atomic<Node*> m_head;
+    Node *m_tail;
+};
+
+template <typename T>
+CommandQueue<T>::CommandQueue()
+{
+    Node *stub = new Node();
+    stub->next.store(nullptr, std::memory_order_relaxed);
+    m_head.store(stub, std::memory_order_relaxed);
+    m_tail = stub;
+}
+
+template <typename T>
+CommandQueue<T>::~CommandQueue()
+{
+    T value;
+    while(pop(value)) {}
+    delete m_tail;
+}
+
+template <typename T>
+void CommandQueue<T>::push(const T &_value)
+{
+    Node *node = new Node();
+    node->value = _value;
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *previous = m_head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+template <typename T>
+bool CommandQueue<T>::pop(T &_value)
+{
+    Node *next = m_tail->next.load(std::memory_order_acquire);
+    if(!next)
+        return false;
+
+    _value = std::move(next->value);
+    next->value = T();
+    delete m_tail;
+    m_tail = next;
+    return true;
+}
+
+template <typename T>
+bool CommandQueue<T>::empty() const
+{
+    return m_tail->next.load(std::memory_order_acquire) == nullptr;
+}
+
+#endif // COMMANDQUEUE_H
@@ -8,6 +8,7 @@
 #include "dynamics/abstractconstraint.h"
 #include "dynamics/particle.h"
 #include "dynamics/dynamicUtils.h"
+#include "dynamics/constraintBatch.h"
 
 
 typedef double Real;
@@ -16,35 +17,6 @@ using Vector3r = Eigen::Matrix<float, 3, 1>;
 
 const double eps = 1e-6;
 
-class HalfSpaceConstraint : public AbstractConstraint
-{
-public:
-    HalfSpaceConstraint(const QVector3D &_p, const QVector3D &_qc, const QVector3D &_n);
-    HalfSpaceConstraint(const ParticlePtr _p, const QVector3D &_qc, const QVector3D &_n);
-
-    void project();
-    float constraintFunction();
-    float constraintFunction(const QVector3D &_p);
-    QVector3D deltaP();
-
-private:
-    float d;
-    ParticlePtr pptr;
-    QVector3D n, p, dp, qc;
-};
-
-class HalfSpacePreConditionConstraint : public AbstractConstraint
-{
-public:
-    HalfSpacePreConditionConstraint(const ParticlePtr _p, const QVector3D &_qc, const QVector3D &_n);
-    void project();
-    float constraintFunction();
-private:
-    float d;
-    ParticlePtr pptr;
-    QVector3D n, p, dp, qc;
-};
-
 class PinConstraint : public AbstractConstraint
 {
 public:
@@ -53,6 +25,7 @@ public:
     float constraintFunction();
     void setPositon(const QVector3D &_pos);
     QVector3D deltaP();
+    const ParticlePtr& getParticle() const;
 private:
     QVector3D pinPosition;
     ParticlePtr particle;
@@ -64,48 +37,18 @@ public:
     PinTogetherConstraint( std::vector<ParticlePtr> &_particleVec);
     void project();
     float constraintFunction();
+    const std::vector<ParticlePtr>& particles() const;
 
 private:
     std::vector< ParticlePtr>       m_particles;
     QVector3D m_avrgPos;
 };
 
-class ParticleParticleConstraint : public AbstractConstraint
-{
-public:
-    ParticleParticleConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
-    ParticleParticleConstraint(const ParticlePtr _p1, const ParticlePtr _p2, float _d);
-    void project();
-    float constraintFunction();
-    QVector3D deltaP();
-    QVector3D getSDFcollisionVector(QVector3D &_vec);
-
-private:
-    int useSDFCollision = false;
-    int id;
-    float d;
-    ParticlePtr pptr1, pptr2;
-};
-
-class ParticleParticlePreConditionConstraint : public AbstractConstraint
-{
-public:
-    ParticleParticlePreConditionConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
-    void project();
-    float constraintFunction();
-    QVector3D deltaP();
-    QVector3D getSDFcollisionVector(QVector3D &_vec);
-private:
-    int useSDFCollision = false;
-    int id;
-    float d;
-    ParticlePtr pptr1, pptr2;
-};
-
+// front end to one entry of the worlds DistanceConstraintBatch
 class DistanceEqualityConstraint : public AbstractConstraint
 {
 public:
-    DistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2 );
+    DistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2, DistanceConstraintBatch *_batch, SlotHandle _handle);
 
     float constraintFunction();
     QVector3D deltaP();
@@ -113,63 +56,80 @@ public:
 
     void setRestLength(float _d);
     float getRestLength();
+    // moves when other constraints are deleted, -1 once this one is
+    int batchIndex();
 
 private:
-    float d, springLength;
-    QVector3D Vp1, Vp2, springDir;
     ParticlePtr pptr1, pptr2;
-    int stretchK, compressK;
+    DistanceConstraintBatch *m_batch;
 };
 
 
+// Müller et al. shape matching. The rotation of Apq * Aqq^-1 comes either
+// from an SVD or from the iterative quaternion method of "A Robust Method to
+// Extract the Rotational Part of Deformations" (Müller 2016), warm started
+// with the rotation of the last projection. Aqq^-1 is fixed by the rest shape.
+// With compliance the whole body is one XPBD constraint,
+// C = sqrt(sum mi |gi - pi|^2), pulled towards its goal by one multiplier.
 class ShapeMatchingConstraint : public AbstractConstraint
 {
 public:
+    enum RotationMethod{
+        SVD,
+        QUATERNION
+    };
+
     ShapeMatchingConstraint();
     ShapeMatchingConstraint(RigidBody *_rigidbody);
     ShapeMatchingConstraint(RigidBodyGrid *_rigidbody);
     void project();
+    void matchShape();
+    QVector3D goalPosition(int _i) const;
     float constraintFunction();
     void preCompute(int numParticles, std::vector<ParticleWeakPtr> &_particles, std::vector<QVector3D> &_restShape);
+    const std::vector<ParticlePtr>& particles() const;
+    const AlignedVector<int>& indices() const;
+    const Eigen::Matrix3f& rotation() const;
+    // the grid whose transform follows the matched rotation, if any
+    RigidBodyGrid* body() const;
+    void setCompliance(float _compliance);
+    void resetLambda(float _dt);
+    bool compliant() const;
+    float complianceFactor();
 
-private:
-    std::vector< ParticlePtr>       m_particles;
-    std::vector< Eigen::Vector3f>   m_restPositions;
+    RotationMethod rotationMethod() const;
+    void setRotationMethod(RotationMethod _method);
 
-    Eigen::Vector3f cm, cmOrigin;
+    static const int maxRotationIterations = 20;
 
-    RigidBody *m_rb;
-    RigidBodyGrid *m_rbg;
-    Eigen::Matrix3f Apq, Aqq, R;
+private:
+    void extractRotation(const Eigen::Matrix3f &_A);
+    void projectCompliant();
 
-    Eigen::Quaternionf q, qPrev;
-};
+    RotationMethod m_rotationMethod = QUATERNION;
 
-class FrictionConstraint : public AbstractConstraint
-{
-public:
-    FrictionConstraint(){}
-    FrictionConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
+    std::vector< ParticlePtr>       m_particles;
 
-    void project();
-    float constraintFunction();
-private:
-    ParticlePtr pptr1, pptr2;
-    QVector3D m_collisionNormal;
-};
+    // particle indices into m_data and the rest offsets relative to the
+    // rest center of mass cmOrigin, laid out for the SIMD reductions
+    ParticleData                    *m_data = nullptr;
+    AlignedVector<int>              m_indices;
+    // first index if the particles are one contiguous block, else -1
+    int                             m_first = -1;
+    AlignedVector<float>            m_restX, m_restY, m_restZ;
 
-class HalfSpaceFrictionConstraint : public AbstractConstraint
-{
-public:
-    HalfSpaceFrictionConstraint(){}
-    HalfSpaceFrictionConstraint(const ParticlePtr _p1, const QVector3D _o, const QVector3D _n);
+    // compliance, compliance / dt^2 and the multiplier of this time step
+    float                           m_compliance = 0;
+    float                           m_alpha = 0;
+    float                           m_lambda = 0;
 
-    void project();
-    float constraintFunction();
-private:
-    ParticlePtr pptr1, pptr2;
-    QVector3D m_collisionNormal, planeOrigin;
+    Eigen::Vector3f cm, cmOrigin;
+
+    RigidBody *m_rb = nullptr;
+    RigidBodyGrid *m_rbg = nullptr;
+    Eigen::Matrix3f Apq, Aqq, AqqInv, R;
 
+    Eigen::Quaternionf q, qPrev;
 };
 
 void polarDecompositionStable(const Matrix3r &M, const double tolerance, Matrix3r &R);
@@ -0,0 +1,104 @@
+#ifndef CONSTRAINTBATCH_H
+#define CONSTRAINTBATCH_H
+
+#include <QVector3D>
+
+#include "dynamics/dynamicUtils.h"
+#include "dynamics/particleData.h"
+#include "dynamics/slotMap.h"
+
+// Distance constraints of a world stored column wise. The solver sweeps the
+// whole batch once per iteration instead of reaching every constraint
+// through the particles it is attached to. A constraint with compliance is
+// solved with XPBD (Macklin et al. 2016), its Lagrange multiplier lives next
+// to it and has to be reset at the start of every time step.
+// Constraints are named by handles, removing one moves the last constraint
+// into its place so the columns stay packed for the sweep. Bending edges of
+// soft bodies are distance constraints too, with a compliance of their own.
+class DistanceConstraintBatch
+{
+public:
+    DistanceConstraintBatch();
+
+    SlotHandle add(int _p1, int _p2, float _restLength, float _stretch = 1.0, float _compress = 1.0, float _compliance = 0.0,
+                   bool _bending = false);
+    // the index the last constraint moved into, -1 for a stale handle
+    int remove(SlotHandle _handle);
+    // current index of the constraint, -1 once it is removed
+    int find(SlotHandle _handle) const;
+    void clear();
+    size_t size() const;
+
+    void project(ParticleData &_particles);
+    void project(ParticleData &_particles, int _idx);
+    bool delta(const ParticleData &_particles, int _idx, QVector3D &_d1, QVector3D &_d2);
+    void setStretch(float _stretch);
+    void setCompress(float _compress);
+    // of all constraints but the bending ones
+    void setCompliance(float _compliance);
+    void setBendingCompliance(float _compliance);
+    void resetLambda(float _dt);
+    float alpha(int _idx) const;
+
+// members :
+    AlignedVector<int> p1, p2;
+    AlignedVector<float> restLength;
+    AlignedVector<float> stretch;
+    AlignedVector<float> compress;
+    AlignedVector<float> compliance;    // inverse stiffness, 0 is rigid
+    AlignedVector<uint8_t> bending;     // 1 for a bending edge
+    AlignedVector<float> lambda;        // multiplier of the current time step
+    float alphaScale = 0;               // 1 / dt^2 of the current time step
+
+private:
+    SlotIndex m_slots;
+};
+
+inline size_t DistanceConstraintBatch::size() const { return p1.size(); };
+inline int DistanceConstraintBatch::find(SlotHandle _handle) const { return m_slots.find(_handle); };
+inline float DistanceConstraintBatch::alpha(int _idx) const { return compliance[_idx] * alphaScale; };
+
+// corrections of a single distance constraint, false if there is nothing to
+// do. _alpha is the compliance over dt^2, without it this is the PBD step
+// scaled by stretch or compress.
+inline bool distanceConstraintDelta(const QVector3D &_p1, const QVector3D &_p2, float _w1, float _w2,
+                                    float _restLength, float _stretch, float _compress,
+                                    float _alpha, float &_lambda,
+                                    QVector3D &_d1, QVector3D &_d2)
+{
+    float wSum = _w1 + _w2;
+    if(wSum <= 0)
+        return false;
+
+    QVector3D springDir = _p1 - _p2;
+    float springLength = springDir.length();
+    if(springLength < 1e-6f)
+        return false;
+
+    float c = springLength - _restLength;
+    float resistance = (springLength > _restLength) ? _stretch : _compress;
+    QVector3D changeDir = springDir / springLength;
+
+    // -dLambda, the multiplier grows against the violation
+    float s = (c + _alpha * _lambda) * resistance / (wSum + _alpha);
+    _lambda -= s;
+
+    _d1 = -(_w1 * s) * changeDir;
+    _d2 =  (_w2 * s) * changeDir;
+    return true;
+}
+
+// single distance projection shared by the batch and DistanceEqualityConstraint
+inline void projectDistanceConstraint(QVector3D &_p1, QVector3D &_p2, float _w1, float _w2,
+                                      float _restLength, float _stretch, float _compress,
+                                      float _alpha, float &_lambda)
+{
+    QVector3D d1, d2;
+    if(!distanceConstraintDelta(_p1, _p2, _w1, _w2, _restLength, _stretch, _compress, _alpha, _lambda, d1, d2))
+        return;
+
+    _p1 += d1;
+    _p2 += d2;
+}
+
+#endif // CONSTRAINTBATCH_H
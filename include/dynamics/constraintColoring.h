@@ -0,0 +1,75 @@
+#ifndef CONSTRAINTCOLORING_H
+#define CONSTRAINTCOLORING_H
+
+#include <vector>
+#include <cstdint>
+
+// Greedy coloring of a constraint graph. Two constraints sharing a particle
+// never get the same color, so all constraints of one color can be projected
+// in parallel without racing on p. Colors are handed out in insertion order,
+// which keeps the solve deterministic for any thread count.
+class ConstraintColoring
+{
+public:
+    static const int maxColors = 64;
+
+    ConstraintColoring();
+
+    void reset(int _numNodes);
+    int add(int _constraint, const int *_nodes, int _count);
+    int add(int _constraint, int _a, int _b = -1);
+    // drops _constraint and renames _last to it, the swap removal of the
+    // constraint storage. The colors of its particles stay taken.
+    void remove(int _constraint, int _last);
+
+    int numColors() const;
+    const std::vector<int>& color(int _color) const;
+    const std::vector<int>& sequential() const;
+
+    template<typename Project>
+    void project(Project _project) const;
+
+private:
+    struct Place
+    {
+        int color;      // -1 sequential, -2 not colored
+        int position;
+    };
+    static const int uncolored = -2;
+
+    std::vector<int>& list(int _color);
+
+    // per node bitmask of the colors already taken by its constraints
+    std::vector<uint64_t> m_used;
+    std::vector<std::vector<int>> m_colors;
+    // constraints that found no free color, projected after the colors
+    std::vector<int> m_sequential;
+    // where each constraint sits in the lists
+    std::vector<Place> m_place;
+};
+
+inline int ConstraintColoring::numColors() const { return int(m_colors.size()); };
+inline const std::vector<int>& ConstraintColoring::color(int _color) const { return m_colors[_color]; };
+inline const std::vector<int>& ConstraintColoring::sequential() const { return m_sequential; };
+
+// calls _project(constraintIndex) for every constraint, one color at a time
+template<typename Project>
+void ConstraintColoring::project(Project _project) const
+{
+    for(const std::vector<int> &c : m_colors)
+    {
+        int n = int(c.size());
+        #pragma omp parallel for if(n > 128)
+        for(int i=0; i < n; i++)
+        {
+            _project(c[i]);
+        }
+    }
+
+    for(int i : m_sequential)
+    {
+        _project(i);
+    }
+}
+
+#endif // CONSTRAINTCOLORING_H
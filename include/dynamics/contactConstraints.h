@@ -0,0 +1,97 @@
+#ifndef CONTACTCONSTRAINTS_H
+#define CONTACTCONSTRAINTS_H
+
+#include <cassert>
+#include <cstdint>
+
+#include <QVector3D>
+
+#include "dynamics/dynamicUtils.h"
+#include "dynamics/particleData.h"
+
+// One contact of the current frame, stored by value.
+struct ContactConstraint
+{
+    enum Type{
+        PARTICLEPARTICLE,
+        FRICTION,
+        HALFSPACE,
+        FRICTIONHALFSPACE,
+        HALFSPACE_PRE
+    };
+
+    // what the other side is, contacts of different targets never share a key
+    enum Target{
+        PARTICLE,
+        COLLIDER,
+        PLANE,
+        TRIANGLE,
+        SDF
+    };
+
+    Type type;
+    int a, b;               // a is a world particle, b indexes other
+    ParticleData *other;    // the world particles or the colliders
+    QVector3D qc, n;        // plane entry point, contact normal. Particle
+                            // contacts without one go along their centers.
+    bool dirty;             // particle and friction contacts project once per frame
+
+    uint64_t key;           // identifies the contact across frames
+    float lambda;           // normal correction applied this frame
+    QVector3D friction;     // tangential correction applied to a this frame
+};
+
+// what a contact remembers from the previous frame
+struct ContactCacheEntry
+{
+    uint64_t key;
+    float lambda;
+    QVector3D friction;
+};
+
+// 3 bits of type and target each, 29 bits for the particle and the index of
+// the other side in its target
+const int contactKeyIndexBits = 29;
+inline uint64_t contactKey(ContactConstraint::Type _type, int _a, ContactConstraint::Target _target, int _other)
+{
+    assert(uint32_t(_a) < (1u << contactKeyIndexBits) && uint32_t(_other) < (1u << contactKeyIndexBits));
+    return (uint64_t(_type) << 61) | (uint64_t(_target) << 58) |
+           (uint64_t(uint32_t(_a)) << contactKeyIndexBits) | uint64_t(uint32_t(_other));
+}
+
+// Per frame storage of all contact constraints. clear() keeps the capacity,
+// so generating and solving contacts does no heap allocation in steady state.
+// The corrections of the last frame are cached by contact key, warmStart()
+// reapplies them to contacts that persist, so stacks start close to rest.
+class ContactArena
+{
+public:
+    ContactArena();
+
+    void clear();
+    void clearCache();
+    size_t size() const;
+
+    // _target is PARTICLE or COLLIDER, _other holds _b
+    int addParticleParticle(int _a, ParticleData *_other, int _b, ContactConstraint::Target _target,
+                            const QVector3D &_n = QVector3D(0,0,0));
+    int addFriction(const ParticleData &_particles, int _a, ParticleData *_other, int _b, ContactConstraint::Target _target);
+    // _target is PLANE, TRIANGLE or SDF, _index the plane, triangle or field
+    int addHalfSpace(int _a, const QVector3D &_qc, const QVector3D &_n, ContactConstraint::Target _target, int _index);
+    int addHalfSpaceFriction(int _a, const QVector3D &_n, ContactConstraint::Target _target, int _index);
+    void addHalfSpacePreCondition(int _a, const QVector3D &_qc, const QVector3D &_n);
+
+    void warmStart(ParticleData &_particles, float _factor);
+    void project(ParticleData &_particles, int _idx);
+    void projectPreConditions(ParticleData &_particles);
+    void updateCache();
+
+// members :
+    AlignedVector<ContactConstraint> m_contacts;
+    AlignedVector<ContactConstraint> m_preConditions;
+    AlignedVector<ContactCacheEntry> m_cache;   // sorted by key
+};
+
+inline size_t ContactArena::size() const { return m_contacts.size(); };
+
+#endif // CONTACTCONSTRAINTS_H
@@ -0,0 +1,35 @@
+#ifndef DISTANCEKERNEL_H
+#define DISTANCEKERNEL_H
+
+#include "dynamics/constraintBatch.h"
+#include "dynamics/particleData.h"
+
+// Projects distance constraints of a DistanceConstraintBatch eight at a time
+// straight from the particle arrays. The constraints handed to project() must
+// not share particles, one color of the solver satisfies that. The widest
+// instruction set the cpu supports is picked on first use.
+class DistanceKernel
+{
+public:
+    enum Isa{
+        SCALAR,
+        SSE,
+        AVX2
+    };
+
+    static Isa detectIsa();
+    static Isa isa();
+    static void setIsa(Isa _isa);
+    static const char* isaName(Isa _isa);
+
+    static void project(DistanceConstraintBatch &_batch, ParticleData &_particles,
+                        const int *_constraints, int _count);
+
+    static const int width = 8;
+
+private:
+    static Isa m_isa;
+    static bool m_detected;
+};
+
+#endif // DISTANCEKERNEL_H
@@ -6,7 +6,6 @@
 #include <QVector3D>
 
 #include <transform.h>
-#include <model.h>
 
 #include "dynamics/dynamicUtils.h"
 
@@ -26,6 +25,9 @@ public:
 
     virtual const QMatrix4x4 getTransfrom();
     virtual const QVector3D getTranslation();
+    // false until a snapshot with its particles was presented, nothing is
+    // drawn before
+    virtual bool presented(){ return true; }
     virtual std::vector<ParticleWeakPtr>& getParticles(){ std::vector<ParticleWeakPtr> vec; return vec; }
     virtual int numParticles(){};
 
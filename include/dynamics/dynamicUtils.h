@@ -7,6 +7,8 @@
 #include <list>
 #include <map>
 #include <set>
+#include <cstdlib>
+#include <new>
 
 #include <eigen3/Eigen/Dense>
 #include <QMatrix3x3>
@@ -25,6 +27,42 @@ typedef std::weak_ptr <Particle>                ParticleWeakPtr;
 typedef std::shared_ptr <AbstractConstraint>    ConstraintPtr;
 typedef std::weak_ptr <AbstractConstraint>      ConstraintWeakPtr;
 
+// std allocator handing out cache line aligned blocks, so the particle
+// arrays start on a fresh line and can be loaded with aligned SIMD loads.
+template<typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T* allocate(std::size_t _n)
+    {
+        void *ptr = nullptr;
+        if(posix_memalign(&ptr, Alignment, _n * sizeof(T)) != 0)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T *_ptr, std::size_t)
+    {
+        std::free(_ptr);
+    }
+};
+
+template<typename T, typename U, std::size_t A>
+bool operator==(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &){ return true; }
+template<typename T, typename U, std::size_t A>
+bool operator!=(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &){ return false; }
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
 template<typename K, typename V>
 // confusing template and function name
 // assumes that V is a container of Ks
@@ -0,0 +1,43 @@
+#ifndef DYNAMICSTHREAD_H
+#define DYNAMICSTHREAD_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+class DynamicsWorld;
+
+// Steps a DynamicsWorld on a thread of its own, in real time by its fixed
+// step clock. The render thread only reads the snapshots the world
+// publishes and talks to it with DynamicsWorld::post(). Edits that change
+// the topology from outside, building a scene or stepping by hand, hold the
+// worker with pause() between two steps.
+class DynamicsThread
+{
+public:
+    DynamicsThread(DynamicsWorld *_world);
+    ~DynamicsThread();
+
+    void start();
+    void stop();
+    bool running() const;
+
+    // the worker waits while the lock is held
+    std::unique_lock<std::mutex> pause();
+
+    // steps taken since the last call
+    int takeSteps();
+
+private:
+    void run();
+
+    DynamicsWorld *m_world;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::atomic<bool> m_running;
+    std::atomic<int> m_steps;
+};
+
+inline bool DynamicsThread::running() const { return m_running; };
+
+#endif // DYNAMICSTHREAD_H
@@ -3,8 +3,10 @@
 
 #include <vector>
 #include <memory>
+#include <functional>
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QVector3D>
 
 //#include <eigen3/Eigen/Dense>
@@ -12,40 +14,135 @@
 #include "transform.h"
 #include "utils.h"
 #include "dynamics/dynamicUtils.h"
-#include "sceneobject.h"
 #include "hashgrid.h"
 #include "dynamics/dynamicObject.h"
 #include "dynamics/particle.h"
+#include "dynamics/particleData.h"
 #include "dynamics/rigidBody.h"
 #include "dynamics/rigidBodyGrid.h"
 #include "dynamics/softBody.h"
 #include "dynamics/singleParticle.h"
 #include "dynamics/collisiondetection.h"
+#include "dynamics/commandQueue.h"
 #include "dynamics/constraint.h"
+#include "dynamics/bodyDamping.h"
+#include "dynamics/bodyScheduler.h"
+#include "dynamics/constraintColoring.h"
+#include "dynamics/contactConstraints.h"
+#include "dynamics/distanceKernel.h"
+#include "dynamics/jacobiSolver.h"
+#include "dynamics/simulationClock.h"
+#include "dynamics/signedDistanceField.h"
+#include "dynamics/simulationIslands.h"
+#include "dynamics/slotMap.h"
+#include "dynamics/triangleMeshCollider.h"
+#include "dynamics/worldSnapshot.h"
 #include "dynamicsWorldController.h"
 
 typedef QVector3D Vec3;
 
-class Scene;
+// told about every particle the world creates for a body. The Scene adds a
+// (hidden) scene object per particle, headless runs don't set a listener.
+class DynamicsWorldListener
+{
+public:
+    virtual ~DynamicsWorldListener() {}
+    virtual void particleAdded(const DynamicObjectPtr _object, ParticlePtr _particle, float _radius, int _color) = 0;
+};
+
+// wall clock time of the phases of the last update() in milliseconds
+struct PhaseTimings
+{
+    double integration = 0;
+    double damping = 0;
+    double broadPhase = 0;
+    double preConditioning = 0;
+    double solve = 0;
+    double velocityUpdate = 0;
+
+    double total() const { return integration + damping + broadPhase + preConditioning + solve + velocityUpdate; }
+};
 
 class DynamicsWorld
 {
     public:
+        enum SolverType{
+            GAUSS_SEIDEL,
+            JACOBI
+        };
+
+        // an edit from another thread, run by the simulation thread
+        typedef std::function<void(DynamicsWorld&)> Command;
+        // a command and the frame it ran before
+        struct RecordedCommand
+        {
+            int frame;
+            Command command;
+        };
+        // a baked field placed in the world, scaled uniformly
+        struct SdfCollider
+        {
+            std::shared_ptr<SignedDistanceField> field;
+            QMatrix4x4 transform, inverse;
+            float scale;
+            uint32_t layer, layerMask;
+        };
+        // all shapes of a model as one mesh in model space, taken on the
+        // render thread and shared by the instances of the model
+        struct ModelMesh
+        {
+            std::vector<QVector3D> vertices;
+            std::vector<unsigned int> indices;
+        };
+        typedef std::shared_ptr<const ModelMesh> ModelMeshPtr;
+
         DynamicsWorld();
         void initialize();
-        void initialize(Scene *_scene);
+        void initialize(DynamicsWorldListener *_listener);
         void update();
+        int advance(double _seconds);
+        double timeToNextStep() const;
+        void publish(float _alpha);
+        void present();
+        float interpolationAlpha() const;
+        int presentedFrame() const;
+        void post(const Command &_command);
+        void processCommands();
+        void setRecording(bool _recording);
+        const std::vector<RecordedCommand>& recordedCommands() const;
+        void replay(const std::vector<RecordedCommand> &_commands);
+        void postToRenderer(const std::function<void()> &_task);
+        void setMaxStepsPerFrame(int _maxSteps);
+        void updateSubsteps();
+        void integrate(float _dt);
+        void predict(float _dt);
+        void updateVelocities(float _dt, float _rest);
         void info();
+        const PhaseTimings& timings() const { return m_timings; }
         DynamicsWorldController* controller();
         void setSimulate(bool _isSimulating);
         void setAllParticlesMass(float _m);
         void setAllDistanceConstraintStretch(float _globalStretch);
         void setAllDistanceConstraintCompress(float _globalCompress);
+        void setAllDistanceConstraintCompliance(float _compliance);
+        void setAllShapeMatchingCompliance(float _compliance);
+        void setAllBendingCompliance(float _compliance);
+        void setShapeMatchingRotationMethod(ShapeMatchingConstraint::RotationMethod _method);
+        void setSleeping(bool _sleeping);
         void reset();
         void step();
         int getTimeStepSizeMS();
 
+        double lap();
         void pbdDamping();
+        void resetMultipliers(float _dt);
+        void projectConstraints();
+        void projectConstraintsJacobi();
+        void projectDistanceConstraints();
+        void projectCollisionConstraints();
+        void colorConstraints();
+        void wakeTouchedIslands();
+        void updateIslands();
         void compare(ParticlePtr _a);
 
         void addDynamicObject(pSceneOb _sceneObject);
@@ -56,24 +153,67 @@ class DynamicsWorld
         void addRope(const QVector3D &_start, const QVector3D &_end, int _numParticles);
         void addDynamicObjectAsRigidBodyGrid(pSceneOb _sceneObject, std::string _path, int _color = 0);
         DynamicObjectPtr addDynamicObjectAsNonUniformParticle(pSceneOb _sceneObject, float radius);
+        void addStaticObjectAsTriangleMesh(pSceneOb _sceneObject, uint32_t _layer = 1, uint32_t _layerMask = 0xffffffff);
+        // fields baked from the model, or loaded from sdfCacheDirectory if
+        // it was baked before. _cellSize is in model space.
+        void addStaticObjectAsSdf(pSceneOb _sceneObject, float _cellSize, uint32_t _layer = 1, uint32_t _layerMask = 0xffffffff);
+        // _sceneObject is only made dynamic, the body is built from _mesh
+        // placed by _transform. Instances of one mesh are baked once.
+        void addDynamicObjectAsSdfRigidBodyGrid(pSceneOb _sceneObject, ModelMeshPtr _mesh, const QMatrix4x4 &_transform,
+                                                float _spacing, int _color = 0);
+        static ModelMeshPtr meshOfModel(ModelPtr _model);
+        std::shared_ptr<RigidBodyGrid> addRigidBodyGrid(const std::vector<QVector3D> &_verts,
+                                                        const std::vector<QVector3D> &_normals,
+                                                        const QMatrix4x4 &_transform, int _color = 0);
+        // particles _spacing apart inside the field, null when none fit
+        std::shared_ptr<RigidBodyGrid> addRigidBodyGrid(const SignedDistanceField &_field, float _spacing,
+                                                        const QMatrix4x4 &_transform, int _color = 0);
+        void notifyParticleAdded(ParticlePtr _particle, int _color = 0);
 
         ParticlePtr getParticlePtrFromRawPtr (Particle *_ptr);
-        ParticlePtr addParticle(float _x, float _y, float _z);
+        ParticlePtr addParticle(const QVector3D &_pos, int _bodyID = 0);
         void addPlane(const Plane &_plane);
+        // static level geometry in world space, particles collide with it
+        // like with planes
+        void addTriangleMesh(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                             uint32_t _layer = 1, uint32_t _layerMask = 0xffffffff);
+        // static, _transform places the field and may only scale uniformly
+        void addSdfCollider(std::shared_ptr<SignedDistanceField> _field, const QMatrix4x4 &_transform,
+                            uint32_t _layer = 1, uint32_t _layerMask = 0xffffffff);
         void collisionCheckAll();
-        void collisionCheck(ParticlePtr p);
+        void findContacts();
+        void emitContacts();
+        float contactMargin(float _dt);
+        void collisionCheck(int _idx, std::vector<ParticleContact> &_contacts);
+        void emitContact(const ParticleContact &_contact);
+        void updateCollisionNormals();
+        QVector3D sdfContactNormal(int _a, int _b) const;
 
-        void checkSphereSphere(const ParticlePtr p1, const ParticlePtr p2);
-        void checkSpherePlane(const ParticlePtr p1, const Plane &_plane);
+        void checkSphereSphere(int _idx, const ParticleData &_other, int _otherIdx,
+                               ParticleContact::Type _type, std::vector<ParticleContact> &_contacts);
+        void checkSpherePlane(int _idx, int _plane, std::vector<ParticleContact> &_contacts);
+        void checkSphereTriangle(int _idx, int _triangle, std::vector<ParticleContact> &_contacts);
+        void checkSphereSdf(int _idx, int _sdf, std::vector<ParticleContact> &_contacts);
 
-        std::shared_ptr<DistanceEqualityConstraint> addDistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
+        // a bending edge takes m_bendingCompliance instead of the distance one
+        std::shared_ptr<DistanceEqualityConstraint> addDistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2,
+                                                                                  bool _bending = false);
         std::shared_ptr<PinTogetherConstraint>      addPinTogetherConstraint(std::vector<ParticlePtr> &_vec);
-        void addParticleParticleConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
-        void addParticleParticlePreConditionConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
-        void addFrictionConstraint(const ParticlePtr _p1, const ParticlePtr _p2);
-        void addHalfSpaceFrictionConstraint(const ParticlePtr _p1, const QVector3D _o, const QVector3D _n);
-        void addHalfSpacePreConditionConstraint(const ParticlePtr _p1, const const QVector3D _qc, const QVector3D _planeNormal);
+        std::shared_ptr<PinConstraint>              addPinConstraint(const ParticlePtr _p, const QVector3D &_pos);
+
+        // edits by particle key, the index of a particle or -1 - the index
+        // of a collider. Commands naming particles by key replay on a world
+        // built the same way.
+        int particleKey(const ParticlePtr &_p) const;
+        ParticlePtr particleFromKey(int _key) const;
+        void pinParticle(int _key, const QVector3D &_pos);
+        void unpinParticle(int _key);
+        void setCollisionLayer(int _key, uint32_t _layer, uint32_t _mask);
+        void addPinTogetherConstraint(const std::vector<int> &_keys);
+        void deletePinTogetherConstraints(int _key);
         void deleteConstraint(const ConstraintPtr _constraint);
+        // tears one distance constraint, false if it is gone already
+        bool deleteDistanceConstraint(SlotHandle _handle);
         void deleteParticle();
 
         void generateData();
@@ -90,24 +230,105 @@ class DynamicsWorld
         int m_frameCount;
         int m_preConditionIteration;
         int m_constraintIteration;
+        // > 1 splits every frame into substeps of one iteration each
+        int m_substeps;
         float m_dt, m_pbdDamping;
+        SolverType m_solverType;
+        float m_overRelaxation;
+        float m_contactWarmStart;
+        bool m_sleeping;
+        float m_sleepVelocity;
+        int m_sleepFrames;
         float m_frictionConstraintStatic, m_frictionConstraintDynamic, m_shapeMatchAttract,
               m_distanceConstraintCompress, m_DistanceConstraintStretch;
+        // XPBD compliance, inverse stiffness. 0 keeps the constraints rigid.
+        float m_distanceConstraintCompliance, m_shapeMatchingCompliance, m_bendingCompliance;
+        ShapeMatchingConstraint::RotationMethod m_shapeMatchingRotation = ShapeMatchingConstraint::QUATERNION;
 
         QVector3D m_gravity;
         DynamicsWorldController         *m_DynamicsWorldController;
         std::vector <DynamicObjectPtr>  m_DynamicObjects;
+        ParticleData                    m_particleData;
+        ParticleData                    m_nonUniformParticleData;
         std::vector <ParticlePtr>       m_Particles;
         std::vector <ParticlePtr>       m_NonUniformParticles;
-        std::vector <ConstraintPtr>     m_Constraints;
+        DistanceConstraintBatch         m_DistanceConstraints;
+        // constraints are deleted by their m_handle in constant time, the
+        // last one of a kind moves into the gap
+        SlotMap <std::shared_ptr<ShapeMatchingConstraint>>  m_ShapeMatchingConstraints;
+        SlotMap <std::shared_ptr<PinTogetherConstraint>>    m_PinTogetherConstraints;
+        SlotMap <std::shared_ptr<PinConstraint>>            m_PinConstraints;
+        ContactArena                    m_contactArena;
+
+        // independent sets for the parallel Gauss-Seidel sweep. Object
+        // constraints are recolored when the topology changes, collisions
+        // every frame while they are generated.
+        ConstraintColoring              m_DistanceColoring;
+        ConstraintColoring              m_ShapeMatchingColoring;
+        ConstraintColoring              m_CollisionColoring;
+        bool                            m_coloringDirty = true;
+
+        // the shape matching colors ordered for per body parallel projection
+        BodyScheduler                   m_ShapeMatchingScheduler;
+
+        JacobiSolver                    m_jacobiSolver;
+        BodyDamping                     m_damping;
+        SimulationIslands               m_islands;
+        size_t                          m_dampingObjects = 0;
         std::vector <Plane>             m_Planes;
+        TriangleMeshCollider            m_triangleMeshes;
+        std::vector <SdfCollider>       m_sdfColliders;
+        // volume samples of sdf rigid grids by mesh and spacing
+        struct SdfSamples
+        {
+            ModelMeshPtr mesh;
+            float spacing;
+            std::vector<QVector3D> points, gradients;
+        };
+        std::vector <SdfSamples>        m_sdfSamples;
+        // some particles carry sdf gradients, their contacts use them
+        bool                            m_sdfParticles = false;
 
-        std::vector<QVector3D*>         m_debugLines;
+        // pairs of particle indices into m_particleData, the distance
+        // constraints of the presented snapshot. Render thread only.
+        std::vector<int>                m_debugLines;
+        int                             m_debugLinesVersion = -1;
+        // bumped whenever a distance constraint is added or deleted
+        int                             m_distanceVersion = 0;
 
         HashGrid m_hashGrid;
+        std::vector<std::vector<ParticleContact>> m_threadContacts;
+        std::vector<ParticleContact>    m_contacts;
+        // the contacts a substepped frame can make, found with m_contactMargin
+        std::vector<ParticleContact>    m_contactCandidates;
+        float                           m_contactMargin = 0;
+        AlignedVector<QVector3D>        m_frameStart;
         CollisionDetection m_CollisionDetect;
 
-        Scene *m_scene;
+        // fixed steps of m_dt for the real time passed to advance(), the
+        // positions before the last step are kept to blend against
+        SimulationClock m_clock;
+        AlignedVector<QVector3D> m_previousX;
+
+        // written by publish() after every advance(), read by present() on
+        // the render thread into the xRender positions
+        SnapshotBuffer m_snapshots;
+        float m_renderAlpha = 1;
+        int m_presentedFrame = 0;
+
+        // edits posted from any thread, run at the start of update(), and
+        // the scene object side of new bodies, run by present()
+        CommandQueue<Command> m_commands;
+        CommandQueue<std::function<void()>> m_renderTasks;
+        bool m_recording = false;
+        std::vector<RecordedCommand> m_recordedCommands;
+        std::vector<RecordedCommand> m_replay;
+        size_t m_replayNext = 0;
+
+        PhaseTimings m_timings;
+        QElapsedTimer m_phaseTimer;
+        qint64 m_phaseStart = 0;
+        DynamicsWorldListener *m_listener = nullptr;
 
 };
 
@@ -23,9 +23,17 @@ protected slots:
     void setTimeStepSize(float _ts);
     void setPreConditionIteration(int _pciter);
     void setConstraintIteration(int _citer);
+    void setSubsteps(int _substeps);
+    void setMaxStepsPerFrame(int _maxSteps);
+    void setSolver(int _solver);
+    void setOverRelaxation(float _omega);
+    void setContactWarmStart(float _factor);
     void setPBDDamping(float _damp);
     void setDistanceConstraintStretch(float _stretch);
     void setDistanceConstraintCompress(float _compress);
+    void setDistanceConstraintCompliance(float _compliance);
+    void setShapeMatchingCompliance(float _compliance);
+    void setBendingCompliance(float _compliance);
     void setShapeMatchingConstraintAttract(float _attract);
 private:
     bool m_simulating;
@@ -0,0 +1,36 @@
+#ifndef JACOBISOLVER_H
+#define JACOBISOLVER_H
+
+#include <vector>
+
+#include <QVector3D>
+
+#include "dynamics/dynamicUtils.h"
+#include "dynamics/particleData.h"
+
+// Accumulates the corrections of constraints projected against the same
+// predicted positions. Every thread writes into its own delta buffer, the
+// partials are summed per particle in apply(), so no atomics are needed.
+class JacobiSolver
+{
+public:
+    JacobiSolver();
+
+    void resize(int _numParticles);
+    void addDelta(int _thread, int _particle, const QVector3D &_delta);
+
+    // p += omega * sum(delta) / count, clears the buffers for the next pass
+    void apply(ParticleData &_particles, float _overRelaxation);
+
+private:
+    std::vector<AlignedVector<QVector3D>> m_delta;
+    std::vector<AlignedVector<float>> m_count;
+};
+
+inline void JacobiSolver::addDelta(int _thread, int _particle, const QVector3D &_delta)
+{
+    m_delta[_thread][_particle] += _delta;
+    m_count[_thread][_particle] += 1.0f;
+}
+
+#endif // JACOBISOLVER_H
@@ -0,0 +1,37 @@
+#ifndef MESHEDGES_H
+#define MESHEDGES_H
+
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+// The constraint network of a triangle mesh over its points, the welded
+// vertices. Every vertex is mapped to its point once, the three edges of
+// each triangle are sorted and made unique, so building it is O(E log E).
+// Two triangles sharing an edge give a bending edge between the points
+// opposite to it, which keeps cloth from folding along the edge freely.
+class MeshEdges
+{
+public:
+    typedef std::pair<int, int> Edge;
+
+    MeshEdges();
+
+    // _pointsToVerts as kept by Shape, the vertices welded into each point
+    void build(const std::map<int, std::list<int>> &_pointsToVerts, const std::vector<unsigned int> &_indices);
+
+    // smaller point first, sorted
+    const std::vector<Edge>& edges() const;
+    // none of them is also in edges()
+    const std::vector<Edge>& bendingEdges() const;
+
+private:
+    std::vector<Edge> m_edges;
+    std::vector<Edge> m_bending;
+};
+
+inline const std::vector<MeshEdges::Edge>& MeshEdges::edges() const { return m_edges; };
+inline const std::vector<MeshEdges::Edge>& MeshEdges::bendingEdges() const { return m_bending; };
+
+#endif // MESHEDGES_H
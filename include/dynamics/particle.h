@@ -6,23 +6,42 @@
 
 #include "dynamics/dynamicUtils.h"
 #include "dynamics/dynamicObject.h"
+#include "dynamics/particleData.h"
 
 class AbstractConstraint;
 
+// lightweight handle, the particle state lives in the worlds ParticleData
 class Particle : public std::enable_shared_from_this<Particle>
 {
 public:
-    Particle();
-    Particle(float _x, float _y, float _z, int _ID);
+    Particle(ParticleData *_data, int _index);
 
     void setRadius(float _radius);
     void setMass(float _mass);
-    void setCell(int _i, int _j, int _k);
-    void setHash(size_t _hashv);
-    int ID = 0;
-    int bodyID = 0;
+    void setID(int _ID);
+    void setBodyID(int _bodyID);
+    // which particles of its own body it collides with, see ParticleData
+    void setCollisionGroup(uint32_t _group, uint32_t _mask);
+    // the collision layers it is in and the ones it collides with
+    void setCollisionLayer(uint32_t _layer, uint32_t _mask);
+    void setCollisionGradient(float _length, const QVector3D &_dir);
+
+    QVector3D& x();
+    QVector3D& p();
+    QVector3D& v();
+    float w();
+    int ID();
+    int bodyID();
+    int index();
+    ParticleData* data();
+    float collisionGradLen();
+    const QVector3D& collisionVector();
 
     QVector3D position();
+    // render thread only, valid once presented()
+    const QVector3D& renderPosition();
+    float renderRadius();
+    bool presented();
     float radius();
     float mass();
     ParticlePtr pointer(Particle *ptr);
@@ -34,26 +53,28 @@ public:
     const QMatrix4x4 getTransfrom();
     const QVector3D getTranslation();
 
-
-
 //members :
-    unsigned age;
-    float w, r, m;
-    float collisionGradLen = 0;
-    size_t hash;
-    QVector3D p, pp, v, vt, x, xt, qc;
-    QVector3D collisionVector;
-    int3 cell;
-
-    std::list<ParticlePtr> m_NonCollisionParticles;
-    std::vector<ConstraintPtr> m_CollisionConstraints;
-
-    std::vector<ConstraintPtr> m_PreConditionConstraints;
     std::vector<ConstraintWeakPtr> m_Constraints;
 
+private:
+    ParticleData *m_data;
+    int m_index;
 };
 
-inline QVector3D Particle::position(){ return x; };
-inline float Particle::radius(){ return r; };
+inline QVector3D& Particle::x(){ return m_data->x[m_index]; };
+inline QVector3D& Particle::p(){ return m_data->p[m_index]; };
+inline QVector3D& Particle::v(){ return m_data->v[m_index]; };
+inline float Particle::w(){ return m_data->w[m_index]; };
+inline int Particle::ID(){ return m_data->ID[m_index]; };
+inline int Particle::bodyID(){ return m_data->bodyID[m_index]; };
+inline int Particle::index(){ return m_index; };
+inline ParticleData* Particle::data(){ return m_data; };
+inline float Particle::collisionGradLen(){ return m_data->collisionGradLen[m_index]; };
+inline const QVector3D& Particle::collisionVector(){ return m_data->collisionVector[m_index]; };
+inline QVector3D Particle::position(){ return m_data->x[m_index]; };
+inline const QVector3D& Particle::renderPosition(){ return m_data->xRender[m_index]; };
+inline float Particle::renderRadius(){ return m_data->rRender[m_index]; };
+inline bool Particle::presented(){ return m_index < int(m_data->xRender.size()); };
+inline float Particle::radius(){ return m_data->r[m_index]; };
 
 #endif // PARTICLE_H
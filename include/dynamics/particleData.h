@@ -0,0 +1,74 @@
+#ifndef PARTICLEDATA_H
+#define PARTICLEDATA_H
+
+#include <cstdint>
+
+#include <QVector3D>
+
+#include "dynamics/dynamicUtils.h"
+
+// Structure of arrays holding the per particle state of a DynamicsWorld.
+// Particles are addressed by their index, a Particle is only a handle into it.
+class ParticleData
+{
+public:
+    ParticleData();
+
+    int add(const QVector3D &_pos, float _mass);
+    void reserve(size_t _n);
+    void clear();
+    void setMass(int _idx, float _mass);
+    size_t size() const;
+    bool collides(int _a, int _b) const;
+    bool collides(int _a, const ParticleData &_other, int _b) const;
+
+// members :
+    AlignedVector<QVector3D> x;             // position
+    AlignedVector<QVector3D> p;             // predicted position
+    AlignedVector<QVector3D> v;             // velocity
+    AlignedVector<QVector3D> xRender;       // drawn position, owned by the render thread
+    AlignedVector<float> w;                 // inverse mass
+    AlignedVector<float> m;                 // mass
+    AlignedVector<float> r;                 // radius
+    AlignedVector<float> rRender;           // drawn radius, owned by the render thread
+    AlignedVector<int> ID;
+    AlignedVector<int> bodyID;
+    // self collision filter. Particles of one body collide if each is in a
+    // group the other ones mask takes, the default mask of 0 keeps a body
+    // from colliding with itself. Different bodies always collide.
+    AlignedVector<uint32_t> group;
+    AlignedVector<uint32_t> groupMask;
+    // one bit per collision layer, a particle is in the layers of layer
+    // and collides with the ones of layerMask. A pair is tested only if
+    // both take the other, a mask of 0 leaves the particle out entirely.
+    AlignedVector<uint32_t> layer;
+    AlignedVector<uint32_t> layerMask;
+
+    // sdf gradient per sample, used for rigid particle-particle contacts.
+    // The depth below the surface of the body and the outward direction in
+    // its rest shape, collisionNormal is that direction rotated with the
+    // body, updated before the contacts of a frame are made.
+    AlignedVector<float> collisionGradLen;
+    AlignedVector<QVector3D> collisionVector;
+    AlignedVector<QVector3D> collisionNormal;
+};
+
+// 32 collision layers, shared by particles and planes
+inline bool collisionLayersMatch(uint32_t _layerA, uint32_t _maskA, uint32_t _layerB, uint32_t _maskB)
+{
+    return (_layerA & _maskB) && (_layerB & _maskA);
+}
+
+inline size_t ParticleData::size() const { return x.size(); };
+inline bool ParticleData::collides(int _a, int _b) const
+{
+    if(!collisionLayersMatch(layer[_a], layerMask[_a], layer[_b], layerMask[_b]))
+        return false;
+    return bodyID[_a] != bodyID[_b] || ((group[_a] & groupMask[_b]) && (group[_b] & groupMask[_a]));
+};
+inline bool ParticleData::collides(int _a, const ParticleData &_other, int _b) const
+{
+    return collisionLayersMatch(layer[_a], layerMask[_a], _other.layer[_b], _other.layerMask[_b]);
+};
+
+#endif // PARTICLEDATA_H
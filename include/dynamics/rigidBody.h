@@ -12,7 +12,7 @@ public:
     RigidBody(ModelPtr _model);
 
     void addParticle(const QVector3D &_localPos, const ParticleWeakPtr _particle);
-    ConstraintPtr createConstraint();
+    std::shared_ptr<ShapeMatchingConstraint> createConstraint();
 
     // virtuals
     void pinToPosition(const QVector3D &_pos);
@@ -12,7 +12,7 @@ public:
     RigidBodyGrid(ModelPtr _model);
 
     void addParticle(const QVector3D &_localPos, const ParticleWeakPtr _particle);
-    ConstraintPtr createConstraint();
+    std::shared_ptr<ShapeMatchingConstraint> createConstraint();
 
     // virtuals
     void pinToPosition(const QVector3D &_pos);
@@ -21,6 +21,14 @@ public:
     const QMatrix4x4 getTransfrom();
     const QVector3D getTranslation();
 
+    // the transform of the last step, the one before it and the one drawn.
+    // There is no previous one until the body was stepped once.
+    const QMatrix4x4& transform() const;
+    void keepPreviousTransform();
+    bool hasPreviousTransform() const;
+    const QMatrix4x4& previousTransform() const;
+    void setRenderTransform(const QMatrix4x4 &_t);
+
     std::vector<ParticleWeakPtr>& getParticles();
     int numParticles();
 
@@ -32,6 +40,9 @@ private:
     ModelPtr m_model;
     ShapePtr m_shape;
     QMatrix4x4 m_t;
+    QMatrix4x4 m_previousT;
+    bool m_hasPreviousT = false;
+    QMatrix4x4 m_renderT;
 
     std::vector<ParticleWeakPtr> m_particles;
 };
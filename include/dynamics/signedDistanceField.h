@@ -0,0 +1,77 @@
+#ifndef SIGNEDDISTANCEFIELD_H
+#define SIGNEDDISTANCEFIELD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <QVector3D>
+
+// Signed distance to a closed triangle mesh on a regular grid, negative
+// inside. Only a narrow band around the surface is stored exactly, in
+// bricks of brickSize^3 nodes. Bricks further out are not allocated and
+// read as +-band, inside or outside as found by a flood fill from the grid
+// border. Distances between the nodes are trilinear.
+class SignedDistanceField
+{
+public:
+    static const int brickSize = 8;
+
+    SignedDistanceField();
+
+    // _band is the width of the exact band on either side, at least a cell
+    void bake(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+              float _cellSize, float _band);
+    // loads the field of the same mesh and parameters from _directory or
+    // bakes and stores it there. An empty directory is the working one.
+    void bakeCached(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                    float _cellSize, float _band, const std::string &_directory);
+
+    bool save(const std::string &_path) const;
+    bool load(const std::string &_path);
+
+    bool empty() const;
+    float distance(const QVector3D &_p) const;
+    // normalized, pointing out of the mesh
+    QVector3D gradient(const QVector3D &_p) const;
+
+    // grid points _spacing apart inside the mesh and, per point, the
+    // outward gradient scaled by its depth. The volume samples of a
+    // RigidBodyGrid.
+    void sampleInterior(float _spacing, std::vector<QVector3D> &_points, std::vector<QVector3D> &_gradients) const;
+
+    const QVector3D& boundsMin() const;
+    const QVector3D& boundsMax() const;
+    // distances from it on are clamped
+    float band() const;
+
+private:
+    enum BrickState{
+        OUTSIDE = -1,
+        INSIDE = -2
+    };
+
+    float node(int _i, int _j, int _k) const;
+    int brickOf(int _i, int _j, int _k) const;
+    float* allocate(int _i, int _j, int _k);
+    static uint64_t meshKey(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                            float _cellSize, float _band);
+
+    QVector3D m_min, m_max;
+    float m_cellSize = 0;
+    float m_band = 0;
+    int m_dims[3] = {0, 0, 0};
+    int m_bricks[3] = {0, 0, 0};
+    uint64_t m_key = 0;
+
+    // per brick the offset into m_values or its BrickState
+    std::vector<int> m_brickIndex;
+    std::vector<float> m_values;
+};
+
+inline bool SignedDistanceField::empty() const { return m_brickIndex.empty(); };
+inline const QVector3D& SignedDistanceField::boundsMin() const { return m_min; };
+inline const QVector3D& SignedDistanceField::boundsMax() const { return m_max; };
+inline float SignedDistanceField::band() const { return m_band; };
+
+#endif // SIGNEDDISTANCEFIELD_H
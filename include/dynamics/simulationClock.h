@@ -0,0 +1,39 @@
+#ifndef SIMULATIONCLOCK_H
+#define SIMULATIONCLOCK_H
+
+// Fixed time step accumulator. Real time goes in with advance(), whole steps
+// of stepSize come out. No more than maxSteps are taken per call, the time
+// beyond that is dropped so a slow frame can't make the next one slower
+// still. alpha() is how far real time has got into the next step, renderers
+// blend the last two steps by it.
+class SimulationClock
+{
+public:
+    SimulationClock(float _stepSize = 0.02, int _maxSteps = 4);
+
+    void setStepSize(float _stepSize);
+    float stepSize() const;
+    void setMaxSteps(int _maxSteps);
+    int maxSteps() const;
+    void reset();
+
+    // the number of steps to take for _seconds of real time
+    int advance(double _seconds);
+    float alpha() const;
+    // real time left until the next step is due
+    double timeToNextStep() const;
+    // real time given up to the step clamp since the last reset
+    double droppedTime() const;
+
+private:
+    float m_stepSize;
+    int m_maxSteps;
+    double m_accumulator = 0;
+    double m_dropped = 0;
+};
+
+inline float SimulationClock::stepSize() const { return m_stepSize; };
+inline int SimulationClock::maxSteps() const { return m_maxSteps; };
+inline double SimulationClock::droppedTime() const { return m_dropped; };
+
+#endif // SIMULATIONCLOCK_H
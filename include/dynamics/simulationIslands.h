@@ -0,0 +1,58 @@
+#ifndef SIMULATIONISLANDS_H
+#define SIMULATIONISLANDS_H
+
+#include <vector>
+
+#include "dynamics/dynamicUtils.h"
+#include "dynamics/particleData.h"
+
+// Simulation islands, the connected parts of the graph of constraints and
+// particle contacts. The islands of the awake particles are found with a
+// union-find every frame. An island whose particles have all been slower
+// than the sleep velocity for a number of frames falls asleep as a whole,
+// its particles are no longer integrated, collided against each other or
+// solved. Sleeping islands keep their label until something touches or
+// pulls on them, then the whole island is woken at once.
+class SimulationIslands
+{
+public:
+    SimulationIslands();
+
+    // new particles start awake
+    void resize(int _numParticles);
+    bool asleep(int _idx) const;
+    int numAsleep() const;
+
+    // the edges of this frames graph, an edge between an awake and a
+    // sleeping particle wakes the sleeping island instead
+    void beginFrame();
+    void connect(int _a, int _b);
+    void connect(const int *_indices, int _count);
+    void keepAwake(int _idx);
+
+    // puts islands to sleep that rested _frames frames, true if any did
+    bool sleep(ParticleData &_particles, float _velocity, int _frames);
+
+    // queues the island of a sleeping particle, woken by wakeQueued()
+    void wake(int _idx);
+    // true if any island woke up
+    bool wakeQueued(ParticleData &_particles);
+    void wakeAll();
+
+private:
+    int find(int _idx);
+
+    AlignedVector<int> m_parent;
+    // island label of a sleeping particle, -1 while awake
+    AlignedVector<int> m_island;
+    // frames a particle has been resting, per root the islands minimum
+    AlignedVector<int> m_restFrames;
+    AlignedVector<int> m_islandRest;
+    std::vector<int> m_wake;
+    int m_numAsleep = 0;
+};
+
+inline bool SimulationIslands::asleep(int _idx) const { return m_island[_idx] >= 0; };
+inline int SimulationIslands::numAsleep() const { return m_numAsleep; };
+
+#endif // SIMULATIONISLANDS_H
@@ -11,6 +11,7 @@ public:
 
     const QMatrix4x4 getTransfrom();
     const QVector3D getTranslation();
+    bool presented();
 
     virtual void pinToPosition(const QVector3D &_pos);
     virtual void endPinToPosition();
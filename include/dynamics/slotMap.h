@@ -0,0 +1,127 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// names an entry of a SlotIndex. The generation of a slot is bumped when
+// its entry is removed, a handle kept past that no longer finds anything.
+struct SlotHandle
+{
+    uint32_t index = invalidIndex;
+    uint32_t generation = 0;
+
+    static const uint32_t invalidIndex = 0xffffffff;
+
+    bool valid() const { return index != invalidIndex; }
+    bool operator==(const SlotHandle &_other) const { return index == _other.index && generation == _other.generation; }
+    bool operator!=(const SlotHandle &_other) const { return !(*this == _other); }
+};
+
+// Maps stable handles onto a dense range 0..size()-1 that the solver sweeps.
+// remove() moves the last dense entry into the hole, so the owner of the
+// dense data does the same move and both stay packed. Insert, remove and
+// find are constant time, freed slots are reused.
+class SlotIndex
+{
+public:
+    SlotIndex();
+
+    SlotHandle insert();
+    // the dense index the last entry moved into, -1 for a stale handle. If
+    // it is size() the removed entry was the last one and nothing moved.
+    int remove(SlotHandle _handle);
+    // dense index of the handle, -1 if it was removed
+    int find(SlotHandle _handle) const;
+    SlotHandle handle(int _dense) const;
+    void clear();
+    int size() const;
+
+private:
+    struct Slot
+    {
+        uint32_t generation = 0;
+        // dense index while in use, next free slot otherwise
+        int dense = -1;
+    };
+
+    std::vector<Slot> m_slots;
+    // slot of each dense entry
+    std::vector<uint32_t> m_denseSlot;
+    int m_freeSlot = -1;
+};
+
+inline int SlotIndex::size() const { return int(m_denseSlot.size()); };
+
+// values kept densely by a SlotIndex, walked like a vector
+template <typename T>
+class SlotMap
+{
+public:
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    SlotHandle insert(const T &_value);
+    bool remove(SlotHandle _handle);
+    // nullptr if the handle was removed
+    T* get(SlotHandle _handle);
+    SlotHandle handle(int _dense) const;
+    void clear();
+
+    std::size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+    T& operator[](int _dense) { return m_values[_dense]; }
+    const T& operator[](int _dense) const { return m_values[_dense]; }
+    iterator begin() { return m_values.begin(); }
+    iterator end() { return m_values.end(); }
+    const_iterator begin() const { return m_values.begin(); }
+    const_iterator end() const { return m_values.end(); }
+
+private:
+    SlotIndex m_index;
+    std::vector<T> m_values;
+};
+
+template <typename T>
+SlotHandle SlotMap<T>::insert(const T &_value)
+{
+    m_values.push_back(_value);
+    return m_index.insert();
+}
+
+template <typename T>
+bool SlotMap<T>::remove(SlotHandle _handle)
+{
+    int hole = m_index.remove(_handle);
+    if(hole < 0)
+        return false;
+
+    if(hole < int(m_values.size()) - 1)
+        m_values[hole] = std::move(m_values.back());
+    m_values.pop_back();
+    return true;
+}
+
+template <typename T>
+T* SlotMap<T>::get(SlotHandle _handle)
+{
+    int dense = m_index.find(_handle);
+    return dense < 0 ? nullptr : &m_values[dense];
+}
+
+template <typename T>
+SlotHandle SlotMap<T>::handle(int _dense) const
+{
+    return m_index.handle(_dense);
+}
+
+template <typename T>
+void SlotMap<T>::clear()
+{
+    m_index.clear();
+    m_values.clear();
+}
+
+#endif // SLOTMAP_H
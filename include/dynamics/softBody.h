@@ -4,6 +4,7 @@
 #include "dynamicObject.h"
 #include "dynamics/dynamicUtils.h"
 #include "dynamics/constraint.h"
+#include "dynamics/meshEdges.h"
 
 class SoftBody : public DynamicObject
 {
@@ -12,7 +13,8 @@ public:
     SoftBody(ModelPtr _model);
 
     void addParticle(const QVector3D &_localPos, const ParticleWeakPtr _particle);
-    std::vector<std::set<int> > createConstraintNetwork();
+    // edges and bending edges between the particles of the first shape
+    MeshEdges createConstraintNetwork();
     void turnOffSelfCollision();
 
     void updateModelBuffers();
@@ -0,0 +1,123 @@
+#ifndef TRIANGLEMESHCOLLIDER_H
+#define TRIANGLEMESHCOLLIDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <QVector3D>
+
+// Static triangle meshes particles collide with, the level geometry. The
+// triangles are kept in a bounding volume hierarchy built with the surface
+// area heuristic over binned centroids. Its nodes are flattened depth first
+// into one array, the left child of an inner node follows it directly.
+class TriangleMeshCollider
+{
+public:
+    struct Triangle
+    {
+        QVector3D a, b, c;
+        QVector3D n;            // unit normal, counter clockwise
+        uint32_t layer;         // collision layers, see ParticleData
+        uint32_t layerMask;
+    };
+
+    // the part of a triangle a closest point lies on
+    enum Feature{
+        FACE,
+        VERTEX_A,
+        VERTEX_B,
+        VERTEX_C,
+        EDGE_AB,
+        EDGE_BC,
+        EDGE_CA
+    };
+
+    struct Node
+    {
+        QVector3D min, max;
+        int first;              // leaf: first triangle, inner: right child
+        int count;              // triangles of a leaf, 0 for inner nodes
+    };
+
+    static const int numBins = 12;
+    static const int maxLeafSize = 8;
+    // keeps the traversal stack of overlap() from running over
+    static const int maxDepth = 60;
+
+    TriangleMeshCollider();
+
+    // _indices are three per triangle into _vertices, given in world space
+    void add(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+             uint32_t _layer = 1, uint32_t _layerMask = 0xffffffff);
+    void clear();
+    // rebuilds the hierarchy if triangles were added, before any query
+    void build();
+
+    bool empty() const;
+    int size() const;
+    const Triangle& triangle(int _idx) const;
+    const std::vector<Node>& nodes() const;
+
+    // calls _visit(triangleIndex) for every triangle whose bounds overlap
+    // the sphere. Only reads, any number of threads may query at once.
+    template<typename Visit>
+    void overlap(const QVector3D &_center, float _radius, Visit _visit) const;
+
+    // closest point of the triangle, _face is true if it lies inside it
+    // rather than on an edge or corner
+    static QVector3D closestPoint(const QVector3D &_p, const Triangle &_t, bool &_face);
+    static QVector3D closestPoint(const QVector3D &_p, const QVector3D &_a, const QVector3D &_b, const QVector3D &_c,
+                                  Feature &_feature);
+
+private:
+    void buildNode(int _node, int _first, int _count, int _depth);
+    void bounds(int _first, int _count, QVector3D &_min, QVector3D &_max,
+                QVector3D &_centroidMin, QVector3D &_centroidMax) const;
+
+    std::vector<Triangle> m_triangles;
+    std::vector<QVector3D> m_centroids;
+    std::vector<Node> m_nodes;
+    bool m_dirty = false;
+};
+
+inline bool TriangleMeshCollider::empty() const { return m_triangles.empty(); };
+inline int TriangleMeshCollider::size() const { return int(m_triangles.size()); };
+inline const TriangleMeshCollider::Triangle& TriangleMeshCollider::triangle(int _idx) const { return m_triangles[_idx]; };
+inline const std::vector<TriangleMeshCollider::Node>& TriangleMeshCollider::nodes() const { return m_nodes; };
+
+template<typename Visit>
+void TriangleMeshCollider::overlap(const QVector3D &_center, float _radius, Visit _visit) const
+{
+    if(m_nodes.empty())
+        return;
+
+    QVector3D r(_radius, _radius, _radius);
+    QVector3D min = _center - r;
+    QVector3D max = _center + r;
+
+    int stack[maxDepth + 2];
+    int top = 0;
+    stack[top++] = 0;
+    while(top)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        if(min.x() > node.max.x() || max.x() < node.min.x() ||
+           min.y() > node.max.y() || max.y() < node.min.y() ||
+           min.z() > node.max.z() || max.z() < node.min.z())
+            continue;
+
+        if(node.count)
+        {
+            for(int i = node.first; i < node.first + node.count; i++)
+                _visit(i);
+        }
+        else
+        {
+            int self = int(&node - m_nodes.data());
+            stack[top++] = node.first;
+            stack[top++] = self + 1;
+        }
+    }
+}
+
+#endif // TRIANGLEMESHCOLLIDER_H
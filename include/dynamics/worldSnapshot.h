@@ -0,0 +1,69 @@
+#ifndef WORLDSNAPSHOT_H
+#define WORLDSNAPSHOT_H
+
+#include <atomic>
+#include <vector>
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+#include "dynamics/dynamicUtils.h"
+
+class RigidBodyGrid;
+
+// what the renderer needs of one state of the world. The positions and body
+// transforms of the last step and the ones before it, blended by alpha plus
+// the real time passed since the snapshot was taken.
+struct WorldSnapshot
+{
+    AlignedVector<QVector3D> x;
+    AlignedVector<QVector3D> previous;
+    AlignedVector<QVector3D> colliders;
+    AlignedVector<float> radii;
+    AlignedVector<float> colliderRadii;
+    std::vector<RigidBodyGrid*> bodies;
+    std::vector<QMatrix4x4> transforms;
+    std::vector<QMatrix4x4> previousTransforms;
+    // distance constraints as pairs of particle indices, copied only when
+    // linesVersion is behind the world
+    std::vector<int> lines;
+    int linesVersion = -1;
+
+    float alpha = 1;
+    float stepSize = 0;
+    // steady clock seconds of publish()
+    double time = 0;
+    int frame = 0;
+};
+
+// Triple buffer of snapshots between the simulation and the render thread.
+// The writer fills back() and swaps it with the middle buffer in publish(),
+// the reader swaps the middle buffer with its front in acquire() if a newer
+// one is there. Neither side ever waits for the other.
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer();
+
+    // writer
+    WorldSnapshot& back();
+    void publish();
+
+    // reader, true if front() changed
+    bool acquire();
+    const WorldSnapshot& front() const;
+
+private:
+    static const int fresh = 4;
+
+    WorldSnapshot m_buffers[3];
+    int m_back = 0;
+    // index of the middle buffer, or'd with fresh until the reader takes it
+    std::atomic<int> m_middle;
+    int m_front = 2;
+};
+
+inline WorldSnapshot& SnapshotBuffer::back() { return m_buffers[m_back]; };
+inline const WorldSnapshot& SnapshotBuffer::front() const { return m_buffers[m_front]; };
+
+#endif // WORLDSNAPSHOT_H
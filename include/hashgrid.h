@@ -1,42 +1,49 @@
 #ifndef HASHGRID_H
 #define HASHGRID_H
 
-#include <unordered_map>
-#include <map>
-#include <list>
-
 #include "utils.h"
-#include "dynamics/particle.h"
-
-
+#include "dynamics/dynamicUtils.h"
+#include "dynamics/particleData.h"
+
+// Spatial hash built by counting sort. Every particle is hashed into one of
+// tableSize buckets, bucket starts are a prefix sum over the counts and the
+// particle indices are stored sorted by bucket, by index inside a bucket.
+// Every pass of a rebuild is O(n) and runs in parallel, all buffers are kept
+// between frames. The particle data itself is not moved. Different cells can
+// share a bucket, callers still have to test the actual distance.
 class HashGrid
 {
 public:
-//    HashGrid();
     HashGrid(float _cellSize = 1.0);
 
     void clear();
     void setGridSize(float _size);
     float getGridSize();
 
-    bool insert(size_t _hashV, ParticlePtr _p);
-    bool cellExists(size_t _hashV);
+    void build(const ParticleData &_particles);
     size_t hashFunction(int3 _cell);
-    size_t hashFunciton(float _i, float _j, float _k);
     int3 pointToCell(float _x, float _y, float _z);
-    std::list<ParticlePtr> query(size_t _hash);
-    std::list<ParticlePtr> cellNeighbours(int3 _cell);
 
-//    int cellNeighboursFunc(int3 _cell, void FUNC);
-
-//  query
+    // sorted particle indices of bucket _hash are [cellStart, cellEnd)
+    int cellStart(size_t _hash) const;
+    int cellEnd(size_t _hash) const;
+    int sortedParticle(int _i) const;
+    size_t particleHash(int _particle) const;
 
 //private:
     float cellSize = 1.0;
-    std::unordered_map< size_t , std::list< ParticlePtr >> m_buckets;
-
-    std::list<ParticlePtr>::iterator tmpList;
+    size_t m_tableMask = 0;
 
+    AlignedVector<int> m_particleHash;      // bucket per particle
+    AlignedVector<int> m_cellStart;         // tableSize + 1 prefix sum
+    AlignedVector<int> m_sortedParticles;   // particle indices sorted by bucket
+    AlignedVector<int> m_cellCount;         // bucket histogram, then scatter cursors
+    AlignedVector<int> m_blockSum;          // per thread totals of the prefix sum
 };
 
+inline int HashGrid::cellStart(size_t _hash) const { return m_cellStart[_hash]; };
+inline int HashGrid::cellEnd(size_t _hash) const { return m_cellStart[_hash + 1]; };
+inline int HashGrid::sortedParticle(int _i) const { return m_sortedParticles[_i]; };
+inline size_t HashGrid::particleHash(int _particle) const { return size_t(m_particleHash[_particle]); };
+
 #endif // HASHGRID_H
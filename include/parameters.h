@@ -13,11 +13,36 @@ static float shapeMatchingGoalAttract              = 1.0;
 static float frictionConstraintDynamicF            = 2.75;
 static float frictionConstraintStaticF             = 2.75;
 static float pbd_Damping                            = 0.03;
+static float distanceConstraintCompliance          = 0.0;
+static float shapeMatchingCompliance               = 0.0;
+// bending edges of soft bodies, soft so they keep their shape only loosely
+static float bendingCompliance                     = 0.01;
 
 static int preConditionIterations                  = 2;
 static int constraintIterations                    = 10;
+static int substeps                                = 1;
+static int solverType                              = 0;
+static float jacobiOverRelaxation                  = 1.0;
+static float contactWarmStart                      = 0.8;
 static float timeStepSize                          = 0.02;
+// fixed steps taken per rendered frame at most, real time beyond is dropped
+static int maxStepsPerFrame                        = 4;
+// steps the world on a thread of its own instead of the render loop
+static bool dynamicsOnThread                       = true;
 static float particleMass                          = 1.0;
+// particles moving less than this in a frame are stopped
+static float restDistance                          = 0.003;
+
+// islands slower than sleepVelocity for sleepFrames frames fall asleep
+static bool islandSleeping                         = true;
+static float sleepVelocity                         = 0.15;
+static int sleepFrames                             = 30;
+
+// signed distance fields baked from models are kept here, an empty path is
+// the working directory. The band is the exact part of static fields in
+// world units, particles are found within it.
+static const char *sdfCacheDirectory               = "";
+static float sdfBand                               = 1.0;
 
 static bool showParticles;
 
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include <unordered_map>
 #include <math.h>
 #include <stdlib.h>
@@ -67,6 +68,9 @@ struct Vertex {
 struct Plane {
     QVector3D Normal;
     QVector3D Offset;
+    // collision layers the plane is in and the ones it collides with
+    uint32_t Layer = 1;
+    uint32_t LayerMask = 0xffffffff;
 };
 
 struct Ray{
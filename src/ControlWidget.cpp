@@ -310,10 +310,29 @@ void DynamicsUiWidget::setupUi()
     preConditionsIterEdit = new ValueSliderI(preConditionIterations, this, 0, 20);
     constraintIterLabel = new QLabel("constraint iter");
     constraintIterEdit = new ValueSliderI(constraintIterations, this, 0, 50);
+    substepsLabel = new QLabel("substeps");
+    substepsEdit = new ValueSliderI(substeps, this, 1, 50);
 
     pbdDampingLabel = new QLabel("PBD Damping");
     pbdDampingEdit = new ValueSliderF(pbd_Damping, this, 0, 1);
 
+    // XPBD compliance, 0 is rigid
+    distanceComplianceLabel = new QLabel("dist compliance");
+    distanceComplianceEdit = new ValueSliderF(distanceConstraintCompliance, this, 0, 0.01, 4);
+    shapeMatchingComplianceLabel = new QLabel("SM compliance");
+    shapeMatchingComplianceEdit = new ValueSliderF(shapeMatchingCompliance, this, 0, 0.01, 4);
+    bendingComplianceLabel = new QLabel("bend compliance");
+    bendingComplianceEdit = new ValueSliderF(bendingCompliance, this, 0, 0.1, 4);
+
+    // in the order of DynamicsWorld::SolverType, over-relaxation is Jacobi only
+    solverLabel = new QLabel("solver");
+    solverEdit = new QComboBox(this);
+    solverEdit->addItem("Gauss-Seidel");
+    solverEdit->addItem("Jacobi");
+    solverEdit->setCurrentIndex(solverType);
+    overRelaxationLabel = new QLabel("Jacobi omega");
+    overRelaxationEdit = new ValueSliderF(jacobiOverRelaxation, this, 0.1, 2);
+
     constraintHeadline = new QLabel("Constraints:");
 
 //    distanceConstraintStretchLabel = new QLabel("Stretch:");
@@ -344,6 +363,9 @@ void DynamicsUiWidget::setupUi()
     layout.addWidget(particleMassLabel,3,0);
     layout.addWidget(particleMassEdit,3,1,1,3);
 
+    layout.addWidget(substepsLabel,4,0);
+    layout.addWidget(substepsEdit,4,1,1,3);
+
     layout.addWidget(constraintIterLabel,5,0);
     layout.addWidget(constraintIterEdit,5,1,1,3);
 
@@ -353,6 +375,21 @@ void DynamicsUiWidget::setupUi()
     layout.addWidget(pbdDampingLabel,7,0);
     layout.addWidget(pbdDampingEdit,7,1,1,3);
 
+    layout.addWidget(distanceComplianceLabel,8,0);
+    layout.addWidget(distanceComplianceEdit,8,1,1,3);
+
+    layout.addWidget(shapeMatchingComplianceLabel,9,0);
+    layout.addWidget(shapeMatchingComplianceEdit,9,1,1,3);
+
+    layout.addWidget(bendingComplianceLabel,10,0);
+    layout.addWidget(bendingComplianceEdit,10,1,1,3);
+
+    layout.addWidget(solverLabel,11,0);
+    layout.addWidget(solverEdit,11,1,1,3);
+
+    layout.addWidget(overRelaxationLabel,12,0);
+    layout.addWidget(overRelaxationEdit,12,1,1,3);
+
 //    layout.addWidget(constraintHeadline,8,0);
 
 //    layout.addWidget(distanceConstraintStretchLabel,9,0);
@@ -32,7 +32,6 @@ GLWidget::GLWidget(QWindow *parent) : QOpenGLWidget()
     m_elpasedTimer.start();
     second = 0;
     previous = m_elpasedTimer.elapsed();
-    lag = 0.0;
     render = 0.0;
 
     m_timer.start();
@@ -73,31 +72,17 @@ void GLWidget::loop()
     processInput();
     inputUpdateTime = timer.elapsed();
 
-    double timeStepSize  = scene()->dynamicsWorld()->getTimeStepSizeMS();
-    int simFrameCounter = 0;
-
-    //// WIP play sim in Realtime
-    while(lag >= timeStepSize)
-    {
-        simFrameCounter++;
-//        mlog<<"lag:"<<lag;
-//        timer.start();
-//        scene()->updateSceneObjects();
-//        scene()->dynamicsWorld()->update();
-//        msDynamics = timer.elapsed();
-//        timer.restart();
-
-        lag -= timeStepSize;
-    }
-//       mlog<<simFrameCounter;
-    simPerFrame = simFrameCounter;
-
-//    QThread::msleep(16);
-
-//    //// play every sim frame
+    // as many fixed steps as the real time since the last tick asks for,
+    // unless the world steps itself on its own thread. The scene objects
+    // pick up the newest snapshot, blended between its last two steps.
     timer.start();
+    DynamicsThread *dynamicsThread = scene()->dynamicsThread();
+    if(dynamicsThread->running())
+        simPerFrame = dynamicsThread->takeSteps();
+    else
+        simPerFrame = scene()->dynamicsWorld()->advance(elapsed * 0.001);
+    scene()->dynamicsWorld()->present();
     scene()->updateSceneObjects();
-    scene()->dynamicsWorld()->update();
     msDynamics = timer.elapsed();
     timer.restart();
 
@@ -129,7 +114,6 @@ void GLWidget::countFPS()
 
     previous = current;
 
-    lag += elapsed;
 
     if(second < 1000)
     {
@@ -164,7 +148,7 @@ void GLWidget::renderText()
         simFPStext =  "-";
     }
     QString a = " sim fps:  " + simFPStext;
-    QString b = " sim frame:  " + QString::number(scene()->dynamicsWorld()->frameCount());
+    QString b = " sim frame:  " + QString::number(scene()->dynamicsWorld()->presentedFrame());
 
     painter.drawText(QRect(5, 5,  200, 50), fps);
     painter.drawText(QRect(5, 19, 200, 50), a);
@@ -370,7 +354,9 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
             {
                 case Qt::Key_Right:{
                         qDebug()<<"register and call update";
-                        scene()->dynamicsWorld()->update();}
+                        auto pause = scene()->dynamicsThread()->pause();
+                        scene()->dynamicsWorld()->update();
+                        scene()->dynamicsWorld()->publish(1);}
                           break;
 
                 case Qt::Key_W:{
@@ -386,6 +372,7 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
                 case Qt::Key_B:{
                             QElapsedTimer timer;
                             timer.start();
+                            auto pause = scene()->dynamicsThread()->pause();
                             scene()->setupScene();
                             mlog<<" setupScene() took: "<<timer.elapsed()<<" ms";
                             }
@@ -404,16 +391,9 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
                         break;
 
                 case Qt::Key_Space:{
-                            if(m_simulating)
-                            {
-                                scene()->dynamicsWorld()->setSimulate(false);
-                                m_simulating = false;
-                            }
-                            else
-                            {
-                                scene()->dynamicsWorld()->setSimulate(true);
-                                m_simulating = true;
-                            }
+                            m_simulating = !m_simulating;
+                            bool simulate = m_simulating;
+                            scene()->dynamicsWorld()->post([simulate](DynamicsWorld &_world){ _world.setSimulate(simulate); });
                         }
                         break;
             }
@@ -49,10 +49,22 @@ void MainWindow::setDynamicsController(DynamicsWorldController *_dwc)
 
       connect(controlWidget->dynamicsWidget->constraintIterEdit, SIGNAL(valueChanged(int)), dwc, SLOT(setConstraintIteration(int)));
 
+      connect(controlWidget->dynamicsWidget->substepsEdit, SIGNAL(valueChanged(int)), dwc, SLOT(setSubsteps(int)));
+
       connect(controlWidget->dynamicsWidget->particleMassEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setParticleMass(float)));
 
       connect(controlWidget->dynamicsWidget->pbdDampingEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setPBDDamping(float)));
 
+      connect(controlWidget->dynamicsWidget->distanceComplianceEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setDistanceConstraintCompliance(float)));
+
+      connect(controlWidget->dynamicsWidget->shapeMatchingComplianceEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setShapeMatchingCompliance(float)));
+
+      connect(controlWidget->dynamicsWidget->bendingComplianceEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setBendingCompliance(float)));
+
+      connect(controlWidget->dynamicsWidget->solverEdit, SIGNAL(currentIndexChanged(int)), dwc, SLOT(setSolver(int)));
+
+      connect(controlWidget->dynamicsWidget->overRelaxationEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setOverRelaxation(float)));
+
       connect(controlWidget->dynamicsWidget->distanceConstraintStretchEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setDistanceConstraintStretch(float)));
 
       connect(controlWidget->dynamicsWidget->distanceConstraintCompressEdit, SIGNAL(valueChanged(float)), dwc, SLOT(setDistanceConstraintCompress(float)));
@@ -2,6 +2,7 @@
 #include <QString>
 
 #include "Scene.h"
+#include "parameters.h"
 
 
 #include <iostream>
@@ -14,7 +15,7 @@ Scene::Scene(GLWidget *_widget) : AbstractScene(_widget)
 
 Scene::~Scene()
 {
-
+    delete m_DynamicsThread;
 }
 
 void Scene::initialize()
@@ -30,6 +31,9 @@ void Scene::initialize()
   QtOpenGLinitialize();
   DynamicsInitialize();
   setupScene();
+
+  if(dynamicsOnThread)
+      m_DynamicsThread->start();
 }
 
 void Scene::addShape(Scene *_scene, std::string _name, const QVector3D *_data, int _size)
@@ -79,7 +83,7 @@ pSceneOb Scene::addSceneObjectFromModel(std::string _name,  uint _materialID,  c
     return pSO;
 }
 
-pSceneOb Scene::addSceneObjectFromParticle(const DynamicObjectPtr _particle, ParticlePtr _p,  int matID)
+pSceneOb Scene::addSceneObjectFromParticle(const DynamicObjectPtr _particle, ParticlePtr _p, float _radius, int matID)
 {
     auto pModel = getModelFromPool("sphere");
     if(pModel == nullptr)
@@ -88,9 +92,11 @@ pSceneOb Scene::addSceneObjectFromParticle(const DynamicObjectPtr _particle, Par
         return nullptr;
     }
 
-    auto pSO = std::make_shared<SceneObject>(this, pModel, matID , _particle->getTranslation());
+    // placed by its first update() once the particle is presented
+    QVector3D pos = _p->presented() ? _p->renderPosition() : QVector3D(0,0,0);
+    auto pSO = std::make_shared<SceneObject>(this, pModel, matID , pos);
     pSO->setActiveObject(widget()->activeObject());
-    pSO->setRadius(_p->radius());
+    pSO->setRadius(_radius);
 
     numCreation++;
     pSO->setID(numCreation);
@@ -101,6 +107,14 @@ pSceneOb Scene::addSceneObjectFromParticle(const DynamicObjectPtr _particle, Par
     return pSO;
 }
 
+// particles of dynamic bodies get a hidden sphere, shown when debugging
+void Scene::particleAdded(const DynamicObjectPtr _object, ParticlePtr _particle, float _radius, int _color)
+{
+    auto pSO = addSceneObjectFromParticle(_object, _particle, _radius, _color);
+    if(pSO)
+        pSO->isHidden(true);
+}
+
 LightPtr Scene::addPointLight(const QVector3D &_pos, const QVector3D &_color)
 {
     auto pLight = std::make_shared<Light>();
@@ -224,6 +238,11 @@ DynamicsWorld* Scene::dynamicsWorld()
     return m_DynamicsWorld;
 }
 
+DynamicsThread* Scene::dynamicsThread()
+{
+    return m_DynamicsThread;
+}
+
 Ray Scene::castRayFromCamera(float ndcX, float ndcY, float depthZ)
 {
     QVector4D ray_clip = QVector4D(ndcX,ndcY,depthZ, 1);
@@ -305,10 +324,15 @@ void Scene::updateLinesVBO()
 {
 // Get lines from dynamicsWorld
     m_Lines.clear();
-    for(QVector3D* _vec : m_DynamicsWorld->m_debugLines)
+    // render thread data only, lines of particles not presented yet are left out
+    const AlignedVector<QVector3D> &xRender = m_DynamicsWorld->m_particleData.xRender;
+    const std::vector<int> &lines = m_DynamicsWorld->m_debugLines;
+    for(size_t i=1; i < lines.size(); i+=2)
     {
-        QVector3D vec = *_vec;
-        m_Lines.push_back(vec);
+        if(lines[i-1] >= int(xRender.size()) || lines[i] >= int(xRender.size()))
+            continue;
+        m_Lines.push_back(xRender[lines[i-1]]);
+        m_Lines.push_back(xRender[lines[i]]);
     }
 
     m_lines_vao->bind();
@@ -550,6 +574,8 @@ void Scene::DynamicsInitialize()
         m_DynamicsWorld = new DynamicsWorld();
 
     m_DynamicsWorld->initialize(this);
+    if(!m_DynamicsThread)
+        m_DynamicsThread = new DynamicsThread(m_DynamicsWorld);
 }
 
 void Scene::resize(int width, int height)
@@ -751,6 +777,32 @@ void Scene::drawScreenQuad()
     m_screen_program->release();
 }
 
+void Scene::addRigidBodyGridCommand(pSceneOb _sceneObject, const std::string &_path, int _color)
+{
+    m_DynamicsWorld->post([_sceneObject, _path, _color](DynamicsWorld &_world){
+        _world.addDynamicObjectAsRigidBodyGrid(_sceneObject, _path, _color);
+    });
+}
+
+// the mesh and placement are read here, the simulation thread doesn't touch
+// the scene object. Instances of a model share its mesh.
+void Scene::addSdfRigidBodyGridCommand(pSceneOb _sceneObject, float _spacing, int _color)
+{
+    ModelPtr model = _sceneObject->model();
+    if(!model)
+        return;
+
+    DynamicsWorld::ModelMeshPtr &cached = m_modelMeshes[model];
+    if(!cached)
+        cached = DynamicsWorld::meshOfModel(model);
+
+    DynamicsWorld::ModelMeshPtr mesh = cached;
+    QMatrix4x4 transform = _sceneObject->getMatrix();
+    m_DynamicsWorld->post([_sceneObject, mesh, transform, _spacing, _color](DynamicsWorld &_world){
+        _world.addDynamicObjectAsSdfRigidBodyGrid(_sceneObject, mesh, transform, _spacing, _color);
+    });
+}
+
 void Scene::setDynamicsWorld(DynamicsWorld *_world)
 {
     m_DynamicsWorld = _world;
@@ -886,7 +938,10 @@ void Scene::setupScene()
        float s = 8;
        auto sceneObjectBallCollider = addSceneObjectFromModel("sphere", m_Materials.size()-1 , QVector3D(-6,0,0), rot);
        sceneObjectBallCollider->setScale(QVector3D(s,s,s));
-       DynamicObjectPtr dynObj = m_DynamicsWorld->addDynamicObjectAsNonUniformParticle(sceneObjectBallCollider, s/2);
+       // bodies are spawned by the simulation thread, before its next step
+       m_DynamicsWorld->post([sceneObjectBallCollider, s](DynamicsWorld &_world){
+           _world.addDynamicObjectAsNonUniformParticle(sceneObjectBallCollider, s/2);
+       });
 //       Particle *ptr = nullptr;
 //       auto particleSmartPointer = dynObj->pointer(ptr);
 //       m_pinnCstr_1 = std::make_shared<PinConstraint>(particleSmartPointer, QVector3D(0,0,0));
@@ -1009,15 +1064,15 @@ void Scene::setupScene()
              if(i % 2 > 0){
                  if(j==0){
                      auto sceneObjectHalf = addSceneObjectFromModel("brick1_high", ((j+i+int(randfinRange(0,i)))%(m_Materials.size()-1)), QVector3D(x - 1.0 , y ,0), rotX);
-                     m_DynamicsWorld->addDynamicObjectAsRigidBodyGrid(sceneObjectHalf , "/Users/enno/Dev/BrickX1_216_volumesample.obj", (i%3));
+                     addSdfRigidBodyGridCommand(sceneObjectHalf , 0.5, (i%3));
                  }
                  x += 2.0;
              }
              auto sceneObjectX = addSceneObjectFromModel("brick2_high", ((j+i+int(randfinRange(0,i)))%(m_Materials.size()-1)), QVector3D(x , y ,0), rotX);
-             m_DynamicsWorld->addDynamicObjectAsRigidBodyGrid(sceneObjectX , "/Users/enno/Dev/BrickX2_216_volumesample.obj", (i%3));
+             addSdfRigidBodyGridCommand(sceneObjectX , 0.5, (i%3));
              if(j == column-1 && i %  2 == 0){
                  auto sceneObjectHalf = addSceneObjectFromModel("brick1_high", ((j+i+int(randfinRange(0,i)))%(m_Materials.size()-1)), QVector3D(x + 3.0 , y ,0), rotX);
-                 m_DynamicsWorld->addDynamicObjectAsRigidBodyGrid(sceneObjectHalf , "/Users/enno/Dev/BrickX1_216_volumesample.obj", (i%3));
+                 addSdfRigidBodyGridCommand(sceneObjectHalf , 0.5, (i%3));
              }
          }
      }
@@ -65,33 +65,35 @@ void ActiveObject::notify(MouseState _mouseState)
 
 }
 
-void ActiveObject::pinConstraintActive()
+// the world steps on its own thread, pins and drags reach it as commands
+// that name the particle by its key
+int ActiveObject::activeParticleKey()
 {
     Particle *ptr = nullptr;
     auto particleSmartPointer = activeSceneObject->dynamicObject()->pointer(ptr);
-    auto pinConstraint = std::make_shared<PinConstraint>(particleSmartPointer, activeSceneObject->getPos());
-    activeSceneObject->setPinConstraint(pinConstraint);
-    particleSmartPointer->m_Constraints.push_back(pinConstraint);
+    return m_GLWidget->scene()->dynamicsWorld()->particleKey(particleSmartPointer);
+}
+
+void ActiveObject::pinConstraintActive()
+{
+    int key = activeParticleKey();
+    QVector3D pos = activeSceneObject->getPos();
+    m_GLWidget->scene()->dynamicsWorld()->post([key, pos](DynamicsWorld &_world){ _world.pinParticle(key, pos); });
 }
 
 void ActiveObject::updatePinConstraintActive()
 {
     if(!activeSceneObject)
         return;
-    {
-         auto pinConstraint  = activeSceneObject->getPinConstraint();
-         if(!pinConstraint)
-             mlog<<"no Cstr-----------";
-         pinConstraint->setPositon(activeSceneObject->getPos());
-    }
+    pinConstraintActive();
 }
 
 void ActiveObject::unpinConstraintActive()
 {
     if(!activeSceneObject)
         return;
-    auto dw = m_GLWidget->scene()->dynamicsWorld();
-    dw->deleteConstraint(activeSceneObject->getPinConstraint());
+    int key = activeParticleKey();
+    m_GLWidget->scene()->dynamicsWorld()->post([key](DynamicsWorld &_world){ _world.unpinParticle(key); });
 }
 
 void ActiveObject::processInput(ActiveObject::AOInput _input)
@@ -200,23 +202,21 @@ void ActiveObject::addParticleToSelection(const ParticlePtr _p)
 
 void ActiveObject::addPinTogetherConstraintToSelection()
 {
-    m_GLWidget->scene()->dynamicsWorld()->addPinTogetherConstraint(m_selection);
+    auto dw = m_GLWidget->scene()->dynamicsWorld();
+    std::vector<int> keys;
+    for(auto p : m_selection)
+    {
+        keys.push_back(dw->particleKey(p));
+    }
+    dw->post([keys](DynamicsWorld &_world){ _world.addPinTogetherConstraint(keys); });
     m_selection.clear();
 }
 
 void ActiveObject::deletePinTogetherConstraintFromSelection()
 {
     if(m_state == SELECTED && activeSceneObject->isDynamic()){
-        Particle *ptr = nullptr;
-        ParticlePtr p = activeSceneObject->dynamicObject()->pointer(ptr);
-        for(auto c : p->m_Constraints)
-        {
-            if(c.lock()->type() == AbstractConstraint::PINTOGETHER)
-            {
-                m_GLWidget->scene()->dynamicsWorld()->deleteConstraint(c.lock());
-            }
-
-        }
+        int key = activeParticleKey();
+        m_GLWidget->scene()->dynamicsWorld()->post([key](DynamicsWorld &_world){ _world.deletePinTogetherConstraints(key); });
     }
 }
 
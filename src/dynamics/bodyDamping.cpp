@@ -0,0 +1,170 @@
+#include "dynamics/bodyDamping.h"
+
+#include <cmath>
+
+#include <eigen3/Eigen/Dense>
+
+static_assert(sizeof(QVector3D) == 3 * sizeof(float), "damping reads QVector3D as three packed floats");
+
+namespace
+{
+struct RangeIndex
+{
+    int first;
+    int operator()(int _i) const { return first + _i; }
+};
+
+struct ListIndex
+{
+    const int *indices;
+    int operator()(int _i) const { return indices[_i]; }
+};
+
+// the three passes over one body, Index maps the i-th particle of the body
+// to its index in ParticleData
+template<typename Index>
+void dampBody(ParticleData &_pd, Index _idx, int _n, float _damping)
+{
+    const float *x = reinterpret_cast<const float*>(_pd.x.data());
+    float *v = reinterpret_cast<float*>(_pd.v.data());
+    const float *m = _pd.m.data();
+
+    float M = 0, cx = 0, cy = 0, cz = 0, ux = 0, uy = 0, uz = 0;
+    #pragma omp simd reduction(+:M,cx,cy,cz,ux,uy,uz)
+    for(int i=0; i < _n; i++)
+    {
+        int k = _idx(i);
+        float mi = m[k];
+        M += mi;
+        cx += mi * x[3 * k];    cy += mi * x[3 * k + 1];    cz += mi * x[3 * k + 2];
+        ux += mi * v[3 * k];    uy += mi * v[3 * k + 1];    uz += mi * v[3 * k + 2];
+    }
+
+    if(M <= 0.001f)
+        return;
+
+    cx /= M;    cy /= M;    cz /= M;
+    ux /= M;    uy /= M;    uz /= M;
+
+    // angular momentum and the inertia tensor sum m (|r|^2 E - r r^T)
+    float lx = 0, ly = 0, lz = 0;
+    float ixx = 0, iyy = 0, izz = 0, ixy = 0, ixz = 0, iyz = 0;
+    #pragma omp simd reduction(+:lx,ly,lz,ixx,iyy,izz,ixy,ixz,iyz)
+    for(int i=0; i < _n; i++)
+    {
+        int k = _idx(i);
+        float mi = m[k];
+        float rx = x[3 * k] - cx, ry = x[3 * k + 1] - cy, rz = x[3 * k + 2] - cz;
+        float vx = v[3 * k], vy = v[3 * k + 1], vz = v[3 * k + 2];
+        lx += mi * (ry * vz - rz * vy);
+        ly += mi * (rz * vx - rx * vz);
+        lz += mi * (rx * vy - ry * vx);
+        ixx += mi * (ry * ry + rz * rz);
+        iyy += mi * (rx * rx + rz * rz);
+        izz += mi * (rx * rx + ry * ry);
+        ixy -= mi * rx * ry;
+        ixz -= mi * rx * rz;
+        iyz -= mi * ry * rz;
+    }
+
+    // a line of particles has no inertia about its axis, such bodies only
+    // keep their linear motion
+    Eigen::Matrix3f I;
+    I << ixx, ixy, ixz,
+         ixy, iyy, iyz,
+         ixz, iyz, izz;
+    Eigen::Matrix3f IInv;
+    bool invertible = false;
+    float det;
+    I.computeInverseAndDetWithCheck(IInv, det, invertible, 1.0e-6f * std::pow(I.trace(), 3.0f));
+    Eigen::Vector3f w = invertible ? Eigen::Vector3f(IInv * Eigen::Vector3f(lx, ly, lz)) : Eigen::Vector3f::Zero();
+    float wx = w.x(), wy = w.y(), wz = w.z();
+
+    #pragma omp simd
+    for(int i=0; i < _n; i++)
+    {
+        int k = _idx(i);
+        float rx = x[3 * k] - cx, ry = x[3 * k + 1] - cy, rz = x[3 * k + 2] - cz;
+        v[3 * k]     += _damping * (ux + wy * rz - wz * ry - v[3 * k]);
+        v[3 * k + 1] += _damping * (uy + wz * rx - wx * rz - v[3 * k + 1]);
+        v[3 * k + 2] += _damping * (uz + wx * ry - wy * rx - v[3 * k + 2]);
+    }
+}
+}
+
+BodyDamping::BodyDamping()
+{
+}
+
+void BodyDamping::clear()
+{
+    m_first.clear();
+    m_offset.clear();
+    m_count.clear();
+    m_indices.clear();
+    m_sleeping.clear();
+    m_numParticles = 0;
+}
+
+void BodyDamping::addBody(const int *_indices, int _count)
+{
+    int first = _count > 0 ? _indices[0] : -1;
+    for(int i=0; i < _count; i++)
+    {
+        if(_indices[i] != first + i)
+        {
+            first = -1;
+            break;
+        }
+    }
+
+    m_first.push_back(first);
+    m_offset.push_back(int(m_indices.size()));
+    m_count.push_back(_count);
+    if(first < 0)
+        m_indices.insert(m_indices.end(), _indices, _indices + _count);
+    m_sleeping.push_back(0);
+    m_numParticles += _count;
+}
+
+void BodyDamping::damp(ParticleData &_particles, float _damping)
+{
+    int numBodies = int(m_count.size());
+
+    #pragma omp parallel for schedule(dynamic, 16) if(m_numParticles >= minParallelWork)
+    for(int b=0; b < numBodies; b++)
+    {
+        if(m_sleeping[b] || m_count[b] < 2)
+            continue;
+
+        if(m_first[b] >= 0)
+        {
+            RangeIndex idx = { m_first[b] };
+            dampBody(_particles, idx, m_count[b], _damping);
+        }
+        else
+        {
+            ListIndex idx = { m_indices.data() + m_offset[b] };
+            dampBody(_particles, idx, m_count[b], _damping);
+        }
+    }
+}
+
+// a body sleeps when the velocity update stopped all of its particles. Next
+// frame gravity moves them all alike (for equal masses), nothing to damp.
+void BodyDamping::updateSleeping(const ParticleData &_particles)
+{
+    int numBodies = int(m_count.size());
+
+    #pragma omp parallel for schedule(dynamic, 16) if(m_numParticles >= minParallelWork)
+    for(int b=0; b < numBodies; b++)
+    {
+        bool asleep = true;
+        for(int i=0; i < m_count[b] && asleep; i++)
+        {
+            int k = m_first[b] >= 0 ? m_first[b] + i : m_indices[m_offset[b] + i];
+            asleep = _particles.v[k].isNull();
+        }
+        m_sleeping[b] = asleep ? 1 : 0;
+    }
+}
@@ -0,0 +1,32 @@
+#include "dynamics/bodyScheduler.h"
+
+#include <algorithm>
+
+BodyScheduler::BodyScheduler()
+{
+}
+
+void BodyScheduler::build(const ConstraintColoring &_coloring, const std::vector<int> &_cost)
+{
+    m_batches.clear();
+    for(int c=0; c < _coloring.numColors(); c++)
+    {
+        if(_coloring.color(c).empty())
+            continue;
+
+        Batch b;
+        b.items = _coloring.color(c);
+        // largest first, ties keep their order
+        std::stable_sort(b.items.begin(), b.items.end(), [&_cost](int _a, int _b)
+        {
+            return _cost[_a] > _cost[_b];
+        });
+
+        b.work = 0;
+        for(int i : b.items)
+            b.work += _cost[i];
+        m_batches.push_back(b);
+    }
+
+    m_sequential = _coloring.sequential();
+}
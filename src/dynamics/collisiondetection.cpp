@@ -1,11 +1,9 @@
 ﻿#include "include/dynamics/collisiondetection.h"
 
-#include <Qdebug>
+#include <QDebug>
 
 #include <math.h>
 
-#include "Scene.h"
-
 CollisionDetection::CollisionDetection()
 {
 }
@@ -2,75 +2,11 @@
 #include "dynamics/rigidBody.h"
 #include "dynamics/rigidBodyGrid.h"
 
-#include "parameters.h"
-
-HalfSpaceConstraint::HalfSpaceConstraint(
-        const QVector3D &_p,
-        const QVector3D &_qc,
-        const QVector3D &_n) :
-    n(_n),
-    p(_p),
-    qc(_qc)
-{
-    m_type = HALFSPACE;
-}
-
-HalfSpaceConstraint::HalfSpaceConstraint(const ParticlePtr _p, const QVector3D &_qc, const QVector3D &_n) :
-        pptr(_p),
-        n(_n),
-        qc(_qc)
-{
-    m_type = HALFSPACE;
-    p = pptr->p;
-}
-
-void HalfSpaceConstraint::project()
-{
-    if(constraintFunction(pptr->p) > 0)
-        return;
-    pptr->p += deltaP();
-}
-
-float HalfSpaceConstraint::constraintFunction()
-{
-    return constraintFunction(pptr->p);
-}
+#include <cmath>
 
-float HalfSpaceConstraint::constraintFunction(const QVector3D &_p)
-{
-    if(_p == qc)
-        return 0;
-    float C = QVector3D::dotProduct((_p-qc),  n);
-    return C;
-}
-
-QVector3D HalfSpaceConstraint::deltaP()
-{
-    return constraintFunction(pptr->p) * -n;
-}
-
-HalfSpacePreConditionConstraint::HalfSpacePreConditionConstraint(const ParticlePtr _p, const QVector3D &_qc, const QVector3D &_n) :
-    pptr(_p),
-    n(_n),
-    qc(_qc)
-{
-    m_type = HALFSPACE_PRE;
-}
+static_assert(sizeof(QVector3D) == 3 * sizeof(float), "shape matching reads QVector3D as three packed floats");
 
-void HalfSpacePreConditionConstraint::project()
-{
-    float c = constraintFunction();
-    pptr->x += c * -n;
-    pptr->p += c * -n;
-}
-
-float HalfSpacePreConditionConstraint::constraintFunction()
-{
-    if(pptr->x == qc)
-        return 0;
-    float C = QVector3D::dotProduct((pptr->x-qc),  n);
-    return C;
-}
+#include "parameters.h"
 
 PinConstraint::PinConstraint(const ParticlePtr _particle, const QVector3D &_pos) :
     pinPosition(_pos) ,
@@ -82,7 +18,7 @@ PinConstraint::PinConstraint(const ParticlePtr _particle, const QVector3D &_pos)
 
 void PinConstraint::project()
 {
-    particle->p = pinPosition;
+    particle->p() = pinPosition;
 }
 
 float PinConstraint::constraintFunction()
@@ -100,246 +36,267 @@ QVector3D PinConstraint::deltaP()
     return pinPosition;
 }
 
-ParticleParticleConstraint::ParticleParticleConstraint(const ParticlePtr _p1, const ParticlePtr _p2) :
-    pptr1(_p1),
-    pptr2(_p2)
+const ParticlePtr& PinConstraint::getParticle() const
 {
-    d = (pptr2->p - pptr1->p).length() - (pptr1->radius() + pptr2->radius());
-    m_type = PARTICLEPARTICLE;
+    return particle;
 }
 
-ParticleParticleConstraint::ParticleParticleConstraint(const ParticlePtr _p1, const ParticlePtr _p2, float _d) :
+DistanceEqualityConstraint::DistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2, DistanceConstraintBatch *_batch, SlotHandle _handle)
+    :
     pptr1(_p1),
     pptr2(_p2),
-    d(_d)
-{
-    m_type = PARTICLEPARTICLE;
-}
-
-void ParticleParticleConstraint::project()
+    m_batch(_batch)
 {
-    if(!m_dirty)
-        return;
-
-    QVector3D n = (pptr2->p - pptr1->p).normalized();
-    float totalWeight = pptr2->w + pptr1->w;
-    d = constraintFunction();
-
-    QVector3D collisionNormal = d * n;
-
-    if(useSDFCollision)
-       getSDFcollisionVector(collisionNormal);
-
-    pptr1->p += (pptr1->w / totalWeight) * collisionNormal;
-    pptr2->p += (pptr2->w / totalWeight) * -collisionNormal;
-
-    m_dirty = false;
+    m_handle = _handle;
+    m_Particles.push_back(_p1);
+    m_Particles.push_back(_p2);
+    m_type = DISTANCE;
 }
 
-
-float ParticleParticleConstraint::constraintFunction()
+float DistanceEqualityConstraint::constraintFunction()
 {
-    return  (pptr2->p - pptr1->p).length() - (pptr1->radius() + pptr2->radius());
+    return (pptr1->p() - pptr2->p()).length() - getRestLength();
 }
 
-QVector3D ParticleParticleConstraint::deltaP()
+QVector3D DistanceEqualityConstraint::deltaP()
 {
     return QVector3D(0,0,0);
 }
 
-QVector3D ParticleParticleConstraint::getSDFcollisionVector(QVector3D &_vec)
-{
-    float maxCollisioGrad = std::max(pptr1->collisionGradLen, pptr2->collisionGradLen);
-    if(maxCollisioGrad >= 0.01)
-    {
-        if(pptr1->collisionGradLen > pptr2->collisionGradLen)
-        {
-            _vec = -pptr1->collisionVector *  pptr1->collisionGradLen;
-        }
-        else{
-            _vec = pptr2->collisionVector *  pptr2->collisionGradLen;
-        }
-    }
-    return  _vec;
-}
-
-ParticleParticlePreConditionConstraint::ParticleParticlePreConditionConstraint(const ParticlePtr _p1, const ParticlePtr _p2) :
-    pptr1(_p1),
-    pptr2(_p2)
-{
-    d = constraintFunction();
-    m_type = PARTICLEPARTICLE_PRE;
-}
-
-void ParticleParticlePreConditionConstraint::project()
+void DistanceEqualityConstraint::project()
 {
-    if(!m_dirty)
+    int idx = batchIndex();
+    if(idx < 0)
         return;
 
-    return;
-
-    QVector3D n = (pptr2->x - pptr1->x).normalized();
-    float totalWeight = pptr2->w + pptr1->w;
-    d = constraintFunction();
-
-    QVector3D collisionNormal = d * n;
-
-    if(useSDFCollision)
-       getSDFcollisionVector(collisionNormal);
-
-    QVector3D correctionA = (pptr1->w / totalWeight) *  collisionNormal;
-    QVector3D correctionB = (pptr2->w / totalWeight) * -collisionNormal;
-
-    pptr1->x += correctionA;
-    pptr2->x += correctionB;
-
-    pptr1->p += correctionA;
-    pptr2->p += correctionB;
-
-    m_dirty = false;
+    projectDistanceConstraint(pptr1->p(), pptr2->p(), pptr1->w(), pptr2->w(),
+                              m_batch->restLength[idx],
+                              m_batch->stretch[idx],
+                              m_batch->compress[idx],
+                              m_batch->alpha(idx),
+                              m_batch->lambda[idx]);
 }
 
-float ParticleParticlePreConditionConstraint::constraintFunction()
+void DistanceEqualityConstraint::setRestLength(float _d)
 {
-    return  (pptr2->p - pptr1->p).length() - (pptr1->radius() + pptr2->radius());
+    int idx = batchIndex();
+    if(idx >= 0)
+        m_batch->restLength[idx] = _d;
 }
 
-QVector3D ParticleParticlePreConditionConstraint::deltaP()
+float DistanceEqualityConstraint::getRestLength()
 {
-    return QVector3D(0,0,0);
+    int idx = batchIndex();
+    return idx >= 0 ? m_batch->restLength[idx] : 0.0f;
 }
 
-QVector3D ParticleParticlePreConditionConstraint::getSDFcollisionVector(QVector3D &_vec)
+int DistanceEqualityConstraint::batchIndex()
 {
-    float maxCollisioGrad = std::max(pptr1->collisionGradLen, pptr2->collisionGradLen);
-    if(maxCollisioGrad >= 0.01)
-    {
-        if(pptr1->collisionGradLen > pptr2->collisionGradLen)
-        {
-            _vec = -pptr1->collisionVector *  pptr1->collisionGradLen;
-        }
-        else{
-            _vec = pptr2->collisionVector *  pptr2->collisionGradLen;
-        }
-    }
-    return  _vec;
+    return m_batch->find(m_handle);
 }
 
-
-DistanceEqualityConstraint::DistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2)
-    :
-    pptr1(_p1),
-    pptr2(_p2)
+ShapeMatchingConstraint::ShapeMatchingConstraint()
 {
-    m_Particles.push_back(_p1);
-    m_Particles.push_back(_p2);
-    m_type = DISTANCE;
+    m_type = SHAPEMATCH;
 }
 
-float DistanceEqualityConstraint::constraintFunction()
+ShapeMatchingConstraint::ShapeMatchingConstraint(RigidBody *_rigidbody)
 {
-    springDir = (pptr1->p - pptr2->p);
-    springLength = springDir.length();
-
-    return (springLength - d);
+    m_type = SHAPEMATCH;
+    m_rb = _rigidbody;
+    m_rbg = nullptr;
+    preCompute(_rigidbody->m_particles.size(), _rigidbody->m_particles, _rigidbody->m_restShape);
 }
 
-QVector3D DistanceEqualityConstraint::deltaP()
+ShapeMatchingConstraint::ShapeMatchingConstraint(RigidBodyGrid *_rigidbody)
 {
-    return QVector3D(0,0,0);
+    m_type = SHAPEMATCH_RIGID;
+    m_rb = nullptr;
+    m_rbg = _rigidbody;
+    preCompute(_rigidbody->m_particles.size(), _rigidbody->m_particles, _rigidbody->m_restShape);
 }
 
-void DistanceEqualityConstraint::project()
+void ShapeMatchingConstraint::project()
 {
-    if(!m_dirty)
+    if(m_indices.empty())
         return;
 
-    float w1, w2;
-    QVector3D dp1, dp2, p1, p2;
+    matchShape();
 
-    float c1 = constraintFunction();
+    if(m_alpha > 0)
+    {
+        projectCompliant();
+        return;
+    }
 
-    float compressR = distanceConstraintCompressR;
-    float strechR = distanceConstraintStrechR;
-    float resistance;
+    float *p = reinterpret_cast<float*>(m_data->p.data());
+    const int *idx = m_indices.data();
+    const float *qx = m_restX.data(), *qy = m_restY.data(), *qz = m_restZ.data();
+    int n = int(m_indices.size());
 
-    if(springLength > d)
-        resistance = strechR;
-    else
-        resistance = compressR;
+    const float r00 = R(0,0), r01 = R(0,1), r02 = R(0,2);
+    const float r10 = R(1,0), r11 = R(1,1), r12 = R(1,2);
+    const float r20 = R(2,0), r21 = R(2,1), r22 = R(2,2);
+    const float cx = cm(0), cy = cm(1), cz = cm(2);
 
-    p1 = pptr1->p;
-    p2 = pptr2->p;
-    w1 = pptr1->w;
-    w2 = pptr2->w;
+    if(m_first >= 0)
+    {
+        float *pb = p + 3 * m_first;
+        #pragma omp simd
+        for(int i=0; i < n; i++)
+        {
+            pb[3 * i]     = r00 * qx[i] + r01 * qy[i] + r02 * qz[i] + cx;
+            pb[3 * i + 1] = r10 * qx[i] + r11 * qy[i] + r12 * qz[i] + cy;
+            pb[3 * i + 2] = r20 * qx[i] + r21 * qy[i] + r22 * qz[i] + cz;
+        }
+        return;
+    }
 
-    QVector3D changeDir = springDir / springLength;
+    // the particles of a body are distinct, the scatter does not collide
+    #pragma omp simd
+    for(int i=0; i < n; i++)
+    {
+        float *pi = p + 3 * idx[i];
+        pi[0] = r00 * qx[i] + r01 * qy[i] + r02 * qz[i] + cx;
+        pi[1] = r10 * qx[i] + r11 * qy[i] + r12 * qz[i] + cy;
+        pi[2] = r20 * qx[i] + r21 * qy[i] + r22 * qz[i] + cz;
+    }
+}
 
-    dp1 =  -(w1/(w1 + w2)) * c1 * changeDir * resistance;
-    dp2 =  +(w2/(w1 + w2)) * c1 * changeDir * resistance;
+// one XPBD step of the body multiplier, the particles move by
+// wi mi f (gi - pi). The gradient of C is -mi (gi - pi) / C, which makes the
+// generalized inverse mass K one unless some particles are fixed.
+float ShapeMatchingConstraint::complianceFactor()
+{
+    const float *p = reinterpret_cast<const float*>(m_data->p.data());
+    const float *w = m_data->w.data();
+    const float *m = m_data->m.data();
+    const int *idx = m_indices.data();
+    const float *qx = m_restX.data(), *qy = m_restY.data(), *qz = m_restZ.data();
+    int n = int(m_indices.size());
 
-    pptr1->p += (dp1 * 1.0);
-    pptr2->p += (dp2 * 1.0);
+    const float r00 = R(0,0), r01 = R(0,1), r02 = R(0,2);
+    const float r10 = R(1,0), r11 = R(1,1), r12 = R(1,2);
+    const float r20 = R(2,0), r21 = R(2,1), r22 = R(2,2);
+    const float cx = cm(0), cy = cm(1), cz = cm(2);
 
-    m_dirty = false;
+    float C2 = 0, K = 0;
+    #pragma omp simd reduction(+:C2,K)
+    for(int i=0; i < n; i++)
+    {
+        const float *pi = p + 3 * idx[i];
+        float dx = r00 * qx[i] + r01 * qy[i] + r02 * qz[i] + cx - pi[0];
+        float dy = r10 * qx[i] + r11 * qy[i] + r12 * qz[i] + cy - pi[1];
+        float dz = r20 * qx[i] + r21 * qy[i] + r22 * qz[i] + cz - pi[2];
+        float d2 = dx * dx + dy * dy + dz * dz;
+        float mi = m[idx[i]];
+        C2 += mi * d2;
+        K += w[idx[i]] * mi * mi * d2;
+    }
 
-}
+    if(C2 < 1e-12f)
+        return 0;
 
-void DistanceEqualityConstraint::setRestLength(float _d)
-{
-    d = _d;
+    float C = std::sqrt(C2);
+    K /= C2;
+    float dLambda = (-C - m_alpha * m_lambda) / (K + m_alpha);
+    m_lambda += dLambda;
+    return -dLambda / C;
 }
 
-float DistanceEqualityConstraint::getRestLength()
+void ShapeMatchingConstraint::projectCompliant()
 {
-    return d;
+    float f = complianceFactor();
+    if(f == 0)
+        return;
+
+    float *p = reinterpret_cast<float*>(m_data->p.data());
+    const float *w = m_data->w.data();
+    const float *m = m_data->m.data();
+    const int *idx = m_indices.data();
+    const float *qx = m_restX.data(), *qy = m_restY.data(), *qz = m_restZ.data();
+    int n = int(m_indices.size());
+
+    const float r00 = R(0,0), r01 = R(0,1), r02 = R(0,2);
+    const float r10 = R(1,0), r11 = R(1,1), r12 = R(1,2);
+    const float r20 = R(2,0), r21 = R(2,1), r22 = R(2,2);
+    const float cx = cm(0), cy = cm(1), cz = cm(2);
+
+    #pragma omp simd
+    for(int i=0; i < n; i++)
+    {
+        float *pi = p + 3 * idx[i];
+        float s = w[idx[i]] * m[idx[i]] * f;
+        pi[0] += s * (r00 * qx[i] + r01 * qy[i] + r02 * qz[i] + cx - pi[0]);
+        pi[1] += s * (r10 * qx[i] + r11 * qy[i] + r12 * qz[i] + cy - pi[1]);
+        pi[2] += s * (r20 * qx[i] + r21 * qy[i] + r22 * qz[i] + cz - pi[2]);
+    }
 }
 
-ShapeMatchingConstraint::ShapeMatchingConstraint()
+void ShapeMatchingConstraint::setCompliance(float _compliance)
 {
-    m_type = SHAPEMATCH;
+    m_compliance = _compliance;
 }
 
-ShapeMatchingConstraint::ShapeMatchingConstraint(RigidBody *_rigidbody)
+void ShapeMatchingConstraint::resetLambda(float _dt)
 {
-    m_type = SHAPEMATCH;
-    m_rb = _rigidbody;
-    m_rbg = nullptr;
-    preCompute(_rigidbody->m_particles.size(), _rigidbody->m_particles, _rigidbody->m_restShape);
+    m_lambda = 0;
+    m_alpha = _dt > 0 ? m_compliance / (_dt * _dt) : 0;
 }
 
-ShapeMatchingConstraint::ShapeMatchingConstraint(RigidBodyGrid *_rigidbody)
+bool ShapeMatchingConstraint::compliant() const
 {
-    m_type = SHAPEMATCH_RIGID;
-    m_rb = nullptr;
-    m_rbg = _rigidbody;
-    preCompute(_rigidbody->m_particles.size(), _rigidbody->m_particles, _rigidbody->m_restShape);
+    return m_alpha > 0;
 }
 
-void ShapeMatchingConstraint::project()
+// finds the best rigid transform of the rest shape onto the predicted positions
+void ShapeMatchingConstraint::matchShape()
 {
-    if(!m_dirty)
+    if(m_indices.empty())
         return;
 
-    cm.setZero();
-    for(auto p : m_particles)
+    const float *p = reinterpret_cast<const float*>(m_data->p.data());
+    const int *idx = m_indices.data();
+    const float *qx = m_restX.data(), *qy = m_restY.data(), *qz = m_restZ.data();
+    int n = int(m_indices.size());
+
+    // the rest offsets sum up to zero, so sum (pi - cm) qi^T = sum pi qi^T
+    // and both come out of one pass over the particles
+    float cx = 0, cy = 0, cz = 0;
+    float a00 = 0, a01 = 0, a02 = 0, a10 = 0, a11 = 0, a12 = 0, a20 = 0, a21 = 0, a22 = 0;
+    if(m_first >= 0)
     {
-        cm += Eigen::Vector3f(p->p.x(), p->p.y(), p->p.z());
+        // bodies are usually added in one go, their particles are one block
+        const float *pb = p + 3 * m_first;
+        #pragma omp simd reduction(+:cx,cy,cz,a00,a01,a02,a10,a11,a12,a20,a21,a22)
+        for(int i=0; i < n; i++)
+        {
+            float px = pb[3 * i], py = pb[3 * i + 1], pz = pb[3 * i + 2];
+            cx += px;   cy += py;   cz += pz;
+            a00 += px * qx[i];  a01 += px * qy[i];  a02 += px * qz[i];
+            a10 += py * qx[i];  a11 += py * qy[i];  a12 += py * qz[i];
+            a20 += pz * qx[i];  a21 += pz * qy[i];  a22 += pz * qz[i];
+        }
     }
-    cm /= m_particles.size();
-
-    Apq.setZero();
-    for(int i=0; i < m_particles.size(); i++)
+    else
     {
-        Eigen::Vector3f pi = Eigen::Vector3f(m_particles[i]->p.x(), m_particles[i]->p.y(), m_particles[i]->p.z()) - cm;
-        Eigen::Vector3f qi = m_restPositions[i] - cmOrigin;
-        Apq += pi * qi.transpose();
+        #pragma omp simd reduction(+:cx,cy,cz,a00,a01,a02,a10,a11,a12,a20,a21,a22)
+        for(int i=0; i < n; i++)
+        {
+            const float *pi = p + 3 * idx[i];
+            float px = pi[0], py = pi[1], pz = pi[2];
+            cx += px;   cy += py;   cz += pz;
+            a00 += px * qx[i];  a01 += px * qy[i];  a02 += px * qz[i];
+            a10 += py * qx[i];  a11 += py * qy[i];  a12 += py * qz[i];
+            a20 += pz * qx[i];  a21 += pz * qy[i];  a22 += pz * qz[i];
+        }
     }
+    cm = Eigen::Vector3f(cx, cy, cz) / float(n);
+    Apq << a00, a01, a02,
+           a10, a11, a12,
+           a20, a21, a22;
 
-    Eigen::Matrix3f A = Apq * Aqq.inverse();
-    Eigen::JacobiSVD<Eigen::MatrixXf> svd(A, Eigen::ComputeThinU | Eigen::ComputeThinV);
-
-    R = svd.matrixU() * svd.matrixV().transpose();
+    extractRotation(Apq * AqqInv);
 
     if(m_type == SHAPEMATCH_RIGID)
     {
@@ -361,17 +318,72 @@ void ShapeMatchingConstraint::project()
 
         m_rbg->m_t(3,3) = 1;
     }
+}
 
-    qPrev = q;
-    q = R;
+void ShapeMatchingConstraint::extractRotation(const Eigen::Matrix3f &_A)
+{
+    if(m_rotationMethod == SVD)
+    {
+        Eigen::JacobiSVD<Eigen::Matrix3f> svd(_A, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        R = svd.matrixU() * svd.matrixV().transpose();
+        qPrev = q;
+        q = R;
+        return;
+    }
 
-    for(int i=0; i < m_particles.size(); i++)
+    // rotate q about the axis that aligns its columns best with the columns
+    // of A, starting from the last rotation it usually takes one or two steps
+    qPrev = q;
+    for(int i=0; i < maxRotationIterations; i++)
     {
-        Eigen::Vector3f qi =  m_restPositions[i] - cmOrigin;
-        Eigen::Vector3f gi = (R * qi) + (cm);
-        m_particles[i]->p = QVector3D(gi.x(), gi.y(), gi.z());
+        Eigen::Matrix3f Ri = q.matrix();
+        Eigen::Vector3f omega = Ri.col(0).cross(_A.col(0)) + Ri.col(1).cross(_A.col(1)) + Ri.col(2).cross(_A.col(2));
+        omega *= 1.0f / (std::fabs(Ri.col(0).dot(_A.col(0)) + Ri.col(1).dot(_A.col(1)) + Ri.col(2).dot(_A.col(2))) + 1.0e-9f);
+
+        float w = omega.norm();
+        if(w < 1.0e-6f)
+            break;
+
+        q = Eigen::Quaternionf(Eigen::AngleAxisf(w, omega / w)) * q;
+        q.normalize();
     }
-    m_dirty = false;
+    R = q.matrix();
+}
+
+ShapeMatchingConstraint::RotationMethod ShapeMatchingConstraint::rotationMethod() const
+{
+    return m_rotationMethod;
+}
+
+void ShapeMatchingConstraint::setRotationMethod(RotationMethod _method)
+{
+    m_rotationMethod = _method;
+}
+
+const Eigen::Matrix3f& ShapeMatchingConstraint::rotation() const
+{
+    return R;
+}
+
+RigidBodyGrid* ShapeMatchingConstraint::body() const
+{
+    return m_rbg;
+}
+
+QVector3D ShapeMatchingConstraint::goalPosition(int _i) const
+{
+    Eigen::Vector3f gi = (R * Eigen::Vector3f(m_restX[_i], m_restY[_i], m_restZ[_i])) + (cm);
+    return QVector3D(gi.x(), gi.y(), gi.z());
+}
+
+const std::vector<ParticlePtr>& ShapeMatchingConstraint::particles() const
+{
+    return m_particles;
+}
+
+const AlignedVector<int>& ShapeMatchingConstraint::indices() const
+{
+    return m_indices;
 }
 
 float ShapeMatchingConstraint::constraintFunction()
@@ -382,107 +394,56 @@ float ShapeMatchingConstraint::constraintFunction()
 
 void ShapeMatchingConstraint:: preCompute(int numParticles, std::vector<ParticleWeakPtr> &_particles, std::vector<QVector3D> &_restShape)
 {
-    q = Eigen::Quaternionf(Eigen::AngleAxisf(0, Eigen::Vector3f(0, 0, 0)));
+    q.setIdentity();
     qPrev = q;
+    R.setIdentity();
 
     cmOrigin = Eigen::Vector3f(0,0,0);
     cm = Eigen::Vector3f(0,0,0);
+    std::vector<Eigen::Vector3f> restPositions;
     for(int i=0; i < _particles.size(); i++)
     {
         auto p = _particles[i];
         if(auto particle = p.lock())
         {
             m_particles.push_back(particle);
+            m_data = particle->data();
+            m_indices.push_back(particle->index());
             Eigen::Vector3f x0 = Eigen::Vector3f(_restShape[i].x(), _restShape[i].y(), _restShape[i].z());
-            m_restPositions.push_back(x0);
+            restPositions.push_back(x0);
             cmOrigin += x0;
         }
     }
     cmOrigin /= m_particles.size();
 
-    Aqq.setZero();
-    for(int i=0; i < _particles.size(); i++)
-    {
-        Eigen::Vector3f x0 = Eigen::Vector3f(_restShape[i].x(), _restShape[i].y(), _restShape[i].z());
-        Eigen::Vector3f qi = x0 - cmOrigin;
-        Eigen::Matrix3f _dot = qi * qi.transpose();
-        Aqq += _dot;
-    }
-}
-
-FrictionConstraint::FrictionConstraint(const ParticlePtr _p1, const ParticlePtr _p2)
-    : pptr1(_p1),
-      pptr2(_p2)
-{
-    m_collisionNormal = (_p2->x - _p1->x).normalized();
-}
-
-void FrictionConstraint::project()
-{
-    if(!m_dirty)
-        return;
-
-    QVector3D td, xj;
-    td = (pptr1->p - pptr1->x)  -  (pptr2->p - pptr2->x) - constraintFunction() * m_collisionNormal;
-    float tdLength = td.length();
-    float totalWeight = pptr1->w + pptr2->w;
-
-    float usd = frictionConstraintStaticF;
-    float ukd = frictionConstraintDynamicF;
-
-    if(tdLength < usd)
+    m_first = m_indices.empty() ? -1 : m_indices[0];
+    for(int i=0; i < int(m_indices.size()); i++)
     {
-        xj = td;
-        pptr1->p += (pptr1->w / totalWeight) * -xj;
-    }
-    else
-    {
-        xj = td * std::min( (ukd / tdLength) , float(1.0));
-        pptr1->p += (pptr1->w / totalWeight) * -xj;
+        if(m_indices[i] != m_first + i)
+        {
+            m_first = -1;
+            break;
+        }
     }
 
-    pptr2->p += (pptr2->w / totalWeight) * xj;
-    m_dirty = false;
-}
-
-float FrictionConstraint::constraintFunction()
-{
-    return QVector3D::dotProduct((pptr1->p - pptr1->x)  -  (pptr2->p - pptr2->x), m_collisionNormal);
-}
-
-HalfSpaceFrictionConstraint::HalfSpaceFrictionConstraint(const ParticlePtr _p1, const QVector3D _o, const QVector3D _n) :
-    pptr1(_p1),
-    m_collisionNormal(_n),
-    planeOrigin(_o)
-{
-
-}
-
-void HalfSpaceFrictionConstraint::project()
-{
-    if(!m_dirty)
-        return;
-    QVector3D td, xj;
-    td = (pptr1->p - pptr1->x)   - constraintFunction() * m_collisionNormal;
-    float tdLength = td.length();
-
-    float usd = 0.5;
-    float ukd = 0.5;
-
-    if(tdLength < usd)
-    {
-        pptr1->p += -td;
-    }
-    else
+    Aqq.setZero();
+    for(const auto &x0 : restPositions)
     {
-        pptr1->p += -td * std::min( (ukd / tdLength) , float(1.0));
+        Eigen::Vector3f qi = x0 - cmOrigin;
+        m_restX.push_back(qi.x());
+        m_restY.push_back(qi.y());
+        m_restZ.push_back(qi.z());
+        Aqq += qi * qi.transpose();
     }
-    m_dirty = false;
-}
 
-float HalfSpaceFrictionConstraint::constraintFunction()
-{
-    return QVector3D::dotProduct((pptr1->p - pptr1->x) , m_collisionNormal);
+    // Aqq only depends on the rest shape. Flat or linear bodies make it
+    // singular, their missing directions are left out of the inverse
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> eigen(Aqq);
+    Eigen::Vector3f lambda = eigen.eigenvalues();
+    float cutoff = 1.0e-6f * lambda.cwiseAbs().maxCoeff();
+    for(int i=0; i < 3; i++)
+        lambda(i) = std::fabs(lambda(i)) > cutoff ? 1.0f / lambda(i) : 0.0f;
+    AqqInv = eigen.eigenvectors() * lambda.asDiagonal() * eigen.eigenvectors().transpose();
 }
 
 PinTogetherConstraint::PinTogetherConstraint(std::vector<ParticlePtr> &_particleVec)
@@ -502,13 +463,13 @@ void PinTogetherConstraint::project()
 
     for(auto p : m_particles)
     {
-        m_avrgPos += p->p;
+        m_avrgPos += p->p();
     }
     m_avrgPos = m_avrgPos / m_particles.size();
 
     for(auto p : m_particles)
     {
-        p->p = m_avrgPos;
+        p->p() = m_avrgPos;
     }
 }
 
@@ -517,3 +478,8 @@ float PinTogetherConstraint::constraintFunction()
     return 1.0;
 }
 
+const std::vector<ParticlePtr>& PinTogetherConstraint::particles() const
+{
+    return m_particles;
+}
+
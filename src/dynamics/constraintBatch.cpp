@@ -0,0 +1,121 @@
+#include "dynamics/constraintBatch.h"
+
+#include <algorithm>
+
+DistanceConstraintBatch::DistanceConstraintBatch()
+{
+}
+
+SlotHandle DistanceConstraintBatch::add(int _p1, int _p2, float _restLength, float _stretch, float _compress, float _compliance,
+                                        bool _bending)
+{
+    p1.push_back(_p1);
+    p2.push_back(_p2);
+    restLength.push_back(_restLength);
+    stretch.push_back(_stretch);
+    compress.push_back(_compress);
+    compliance.push_back(_compliance);
+    bending.push_back(_bending ? 1 : 0);
+    lambda.push_back(0);
+    return m_slots.insert();
+}
+
+template<typename T>
+static void moveLast(AlignedVector<T> &_column, int _to)
+{
+    _column[_to] = _column.back();
+    _column.pop_back();
+}
+
+int DistanceConstraintBatch::remove(SlotHandle _handle)
+{
+    int hole = m_slots.remove(_handle);
+    if(hole < 0)
+        return -1;
+
+    moveLast(p1, hole);
+    moveLast(p2, hole);
+    moveLast(restLength, hole);
+    moveLast(stretch, hole);
+    moveLast(compress, hole);
+    moveLast(compliance, hole);
+    moveLast(bending, hole);
+    moveLast(lambda, hole);
+    return hole;
+}
+
+void DistanceConstraintBatch::clear()
+{
+    m_slots.clear();
+    p1.clear();
+    p2.clear();
+    restLength.clear();
+    stretch.clear();
+    compress.clear();
+    compliance.clear();
+    bending.clear();
+    lambda.clear();
+}
+
+void DistanceConstraintBatch::project(ParticleData &_particles)
+{
+    int numConstraints = int(size());
+    for(int i=0; i < numConstraints; i++)
+    {
+        project(_particles, i);
+    }
+}
+
+void DistanceConstraintBatch::project(ParticleData &_particles, int _idx)
+{
+    int a = p1[_idx];
+    int b = p2[_idx];
+    projectDistanceConstraint(_particles.p[a], _particles.p[b],
+                              _particles.w[a], _particles.w[b],
+                              restLength[_idx], stretch[_idx], compress[_idx],
+                              alpha(_idx), lambda[_idx]);
+}
+
+bool DistanceConstraintBatch::delta(const ParticleData &_particles, int _idx, QVector3D &_d1, QVector3D &_d2)
+{
+    int a = p1[_idx];
+    int b = p2[_idx];
+    return distanceConstraintDelta(_particles.p[a], _particles.p[b],
+                                   _particles.w[a], _particles.w[b],
+                                   restLength[_idx], stretch[_idx], compress[_idx],
+                                   alpha(_idx), lambda[_idx], _d1, _d2);
+}
+
+void DistanceConstraintBatch::setStretch(float _stretch)
+{
+    std::fill(stretch.begin(), stretch.end(), _stretch);
+}
+
+void DistanceConstraintBatch::setCompress(float _compress)
+{
+    std::fill(compress.begin(), compress.end(), _compress);
+}
+
+void DistanceConstraintBatch::setCompliance(float _compliance)
+{
+    for(size_t i=0; i < compliance.size(); i++)
+    {
+        if(!bending[i])
+            compliance[i] = _compliance;
+    }
+}
+
+void DistanceConstraintBatch::setBendingCompliance(float _compliance)
+{
+    for(size_t i=0; i < compliance.size(); i++)
+    {
+        if(bending[i])
+            compliance[i] = _compliance;
+    }
+}
+
+void DistanceConstraintBatch::resetLambda(float _dt)
+{
+    std::fill(lambda.begin(), lambda.end(), 0.0f);
+    alphaScale = _dt > 0 ? 1.0f / (_dt * _dt) : 0.0f;
+}
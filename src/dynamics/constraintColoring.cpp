@@ -0,0 +1,86 @@
+#include "dynamics/constraintColoring.h"
+
+ConstraintColoring::ConstraintColoring()
+{
+}
+
+void ConstraintColoring::reset(int _numNodes)
+{
+    m_used.assign(_numNodes, 0);
+    for(auto &c : m_colors)
+        c.clear();
+    m_sequential.clear();
+    m_place.clear();
+}
+
+int ConstraintColoring::add(int _constraint, const int *_nodes, int _count)
+{
+    if(_constraint >= int(m_place.size()))
+        m_place.resize(_constraint + 1, Place{uncolored, 0});
+
+    uint64_t taken = 0;
+    for(int i=0; i < _count; i++)
+    {
+        if(_nodes[i] >= 0)
+            taken |= m_used[_nodes[i]];
+    }
+
+    if(~taken == 0)
+    {
+        m_place[_constraint] = Place{-1, int(m_sequential.size())};
+        m_sequential.push_back(_constraint);
+        return -1;
+    }
+
+    int color = 0;
+    while(taken & (uint64_t(1) << color))
+        color++;
+
+    for(int i=0; i < _count; i++)
+    {
+        if(_nodes[i] >= 0)
+            m_used[_nodes[i]] |= uint64_t(1) << color;
+    }
+
+    if(color >= int(m_colors.size()))
+        m_colors.resize(color + 1);
+    m_place[_constraint] = Place{color, int(m_colors[color].size())};
+    m_colors[color].push_back(_constraint);
+    return color;
+}
+
+int ConstraintColoring::add(int _constraint, int _a, int _b)
+{
+    int nodes[2] = {_a, _b};
+    return add(_constraint, nodes, 2);
+}
+
+std::vector<int>& ConstraintColoring::list(int _color)
+{
+    return _color < 0 ? m_sequential : m_colors[_color];
+}
+
+// constraints of one color are independent, filling the hole with the last
+// of them keeps the sweep packed
+void ConstraintColoring::remove(int _constraint, int _last)
+{
+    if(_constraint < int(m_place.size()) && m_place[_constraint].color != uncolored)
+    {
+        Place place = m_place[_constraint];
+        std::vector<int> &l = list(place.color);
+        int moved = l.back();
+        l[place.position] = moved;
+        m_place[moved].position = place.position;
+        l.pop_back();
+        m_place[_constraint].color = uncolored;
+    }
+
+    if(_last == _constraint || _last >= int(m_place.size()))
+        return;
+
+    Place place = m_place[_last];
+    if(place.color != uncolored)
+        list(place.color)[place.position] = _constraint;
+    m_place[_constraint] = place;
+    m_place[_last].color = uncolored;
+}
@@ -0,0 +1,320 @@
+#include "dynamics/contactConstraints.h"
+
+#include <algorithm>
+
+#include "parameters.h"
+
+static inline ContactConstraint makeContact(ContactConstraint::Type _type, int _a, ParticleData *_other, int _b,
+                                            ContactConstraint::Target _target, int _index)
+{
+    ContactConstraint c;
+    c.type = _type;
+    c.a = _a;
+    c.b = _b;
+    c.other = _other;
+    c.dirty = true;
+    c.n = QVector3D(0,0,0);
+    c.key = contactKey(_type, _a, _target, _index);
+    c.lambda = 0;
+    c.friction = QVector3D(0,0,0);
+    return c;
+}
+
+ContactArena::ContactArena()
+{
+}
+
+void ContactArena::clear()
+{
+    m_contacts.clear();
+    m_preConditions.clear();
+}
+
+void ContactArena::clearCache()
+{
+    m_cache.clear();
+}
+
+int ContactArena::addParticleParticle(int _a, ParticleData *_other, int _b, ContactConstraint::Target _target, const QVector3D &_n)
+{
+    ContactConstraint c = makeContact(ContactConstraint::PARTICLEPARTICLE, _a, _other, _b, _target, _b);
+    c.n = _n;
+    m_contacts.push_back(c);
+    return int(m_contacts.size()) - 1;
+}
+
+int ContactArena::addFriction(const ParticleData &_particles, int _a, ParticleData *_other, int _b, ContactConstraint::Target _target)
+{
+    ContactConstraint c = makeContact(ContactConstraint::FRICTION, _a, _other, _b, _target, _b);
+    c.n = (_other->x[_b] - _particles.x[_a]).normalized();
+    m_contacts.push_back(c);
+    return int(m_contacts.size()) - 1;
+}
+
+int ContactArena::addHalfSpace(int _a, const QVector3D &_qc, const QVector3D &_n, ContactConstraint::Target _target, int _index)
+{
+    ContactConstraint c = makeContact(ContactConstraint::HALFSPACE, _a, nullptr, -1, _target, _index);
+    c.qc = _qc;
+    c.n = _n;
+    m_contacts.push_back(c);
+    return int(m_contacts.size()) - 1;
+}
+
+int ContactArena::addHalfSpaceFriction(int _a, const QVector3D &_n, ContactConstraint::Target _target, int _index)
+{
+    ContactConstraint c = makeContact(ContactConstraint::FRICTIONHALFSPACE, _a, nullptr, -1, _target, _index);
+    c.n = _n;
+    m_contacts.push_back(c);
+    return int(m_contacts.size()) - 1;
+}
+
+void ContactArena::addHalfSpacePreCondition(int _a, const QVector3D &_qc, const QVector3D &_n)
+{
+    ContactConstraint c = makeContact(ContactConstraint::HALFSPACE_PRE, _a, nullptr, -1, ContactConstraint::PLANE, 0);
+    c.qc = _qc;
+    c.n = _n;
+    m_preConditions.push_back(c);
+}
+
+// gap between two particles along the contact normal _n, or their centers
+// if it has none, and the direction _dir used
+static inline float separation(const QVector3D &_p1, const QVector3D &_p2, float _radii, const QVector3D &_n, QVector3D &_dir)
+{
+    if(_n.isNull())
+    {
+        _dir = (_p2 - _p1).normalized();
+        return (_p2 - _p1).length() - _radii;
+    }
+    _dir = _n;
+    return QVector3D::dotProduct(_p2 - _p1, _n) - _radii;
+}
+
+static bool cacheLess(const ContactCacheEntry &_entry, uint64_t _key)
+{
+    return _entry.key < _key;
+}
+
+// Moves persisting contacts by a fraction of last frames correction before
+// the solver runs. The correction is capped by the current penetration and
+// tangential slip, so warm starting never pushes contacts apart or injects
+// velocity. Friction is only carried over for contacts that stuck.
+void ContactArena::warmStart(ParticleData &_particles, float _factor)
+{
+    if(m_cache.empty() || _factor <= 0)
+        return;
+
+    for(ContactConstraint &c : m_contacts)
+    {
+        auto it = std::lower_bound(m_cache.begin(), m_cache.end(), c.key, cacheLess);
+        if(it == m_cache.end() || it->key != c.key)
+            continue;
+
+        QVector3D &p1 = _particles.p[c.a];
+        float w1 = _particles.w[c.a];
+
+        switch(c.type)
+        {
+            case ContactConstraint::PARTICLEPARTICLE:
+            {
+                QVector3D &p2 = c.other->p[c.b];
+                float w2 = c.other->w[c.b];
+                float totalWeight = w1 + w2;
+                if(totalWeight <= 0)
+                    break;
+
+                QVector3D n;
+                float penetration = -separation(p1, p2, _particles.r[c.a] + c.other->r[c.b], c.n, n);
+                float lambda = std::min(_factor * it->lambda, penetration);
+                if(lambda <= 0)
+                    break;
+
+                p1 -= (w1 / totalWeight) * lambda * n;
+                p2 += (w2 / totalWeight) * lambda * n;
+                c.lambda = lambda;
+                break;
+            }
+            case ContactConstraint::HALFSPACE:
+            {
+                float penetration = -QVector3D::dotProduct((p1 - c.qc), c.n);
+                float lambda = std::min(_factor * it->lambda, penetration);
+                if(lambda <= 0)
+                    break;
+
+                p1 += lambda * c.n;
+                c.lambda = lambda;
+                break;
+            }
+            case ContactConstraint::FRICTION:
+            {
+                if(it->friction.length() >= frictionConstraintStaticF)
+                    break;
+
+                QVector3D &p2 = c.other->p[c.b];
+                float w2 = c.other->w[c.b];
+                float totalWeight = w1 + w2;
+                if(totalWeight <= 0)
+                    break;
+
+                QVector3D dx = (p1 - _particles.x[c.a]) - (p2 - c.other->x[c.b]);
+                QVector3D td = dx - QVector3D::dotProduct(dx, c.n) * c.n;
+                float tdLength = td.length();
+                if(tdLength <= 0)
+                    break;
+
+                QVector3D t = -td * (std::min(_factor * it->friction.length(), tdLength) / tdLength);
+                p1 += (w1 / totalWeight) * t;
+                p2 -= (w2 / totalWeight) * t;
+                c.friction = t;
+                break;
+            }
+            case ContactConstraint::FRICTIONHALFSPACE:
+            {
+                if(it->friction.length() >= 0.5)
+                    break;
+
+                QVector3D dx = p1 - _particles.x[c.a];
+                QVector3D td = dx - QVector3D::dotProduct(dx, c.n) * c.n;
+                float tdLength = td.length();
+                if(tdLength <= 0)
+                    break;
+
+                QVector3D t = -td * (std::min(_factor * it->friction.length(), tdLength) / tdLength);
+                p1 += t;
+                c.friction = t;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+// remembers the corrections of this frame, call before clear()
+void ContactArena::updateCache()
+{
+    m_cache.clear();
+    for(const ContactConstraint &c : m_contacts)
+    {
+        ContactCacheEntry entry;
+        entry.key = c.key;
+        entry.lambda = c.lambda;
+        entry.friction = c.friction;
+        m_cache.push_back(entry);
+    }
+    std::sort(m_cache.begin(), m_cache.end(),
+              [](const ContactCacheEntry &_a, const ContactCacheEntry &_b){ return _a.key < _b.key; });
+}
+
+void ContactArena::project(ParticleData &_particles, int _idx)
+{
+    ContactConstraint &c = m_contacts[_idx];
+    QVector3D &p1 = _particles.p[c.a];
+
+    switch(c.type)
+    {
+        case ContactConstraint::PARTICLEPARTICLE:
+        {
+            if(!c.dirty)
+                return;
+
+            QVector3D &p2 = c.other->p[c.b];
+            float w1 = _particles.w[c.a];
+            float w2 = c.other->w[c.b];
+            float totalWeight = w1 + w2;
+            if(totalWeight > 0)
+            {
+                QVector3D n;
+                float d = separation(p1, p2, _particles.r[c.a] + c.other->r[c.b], c.n, n);
+
+                // a warm started contact may already be apart
+                if(d < 0)
+                {
+                    QVector3D collisionNormal = d * n;
+                    p1 += (w1 / totalWeight) * collisionNormal;
+                    p2 += (w2 / totalWeight) * -collisionNormal;
+                    c.lambda -= d;
+                }
+            }
+            c.dirty = false;
+            break;
+        }
+        case ContactConstraint::FRICTION:
+        {
+            if(!c.dirty)
+                return;
+
+            QVector3D &p2 = c.other->p[c.b];
+            float w1 = _particles.w[c.a];
+            float w2 = c.other->w[c.b];
+            float totalWeight = w1 + w2;
+            if(totalWeight > 0)
+            {
+                QVector3D dx = (p1 - _particles.x[c.a]) - (p2 - c.other->x[c.b]);
+                QVector3D td = dx - QVector3D::dotProduct(dx, c.n) * c.n;
+                float tdLength = td.length();
+
+                float usd = frictionConstraintStaticF;
+                float ukd = frictionConstraintDynamicF;
+
+                QVector3D xj = td;
+                if(tdLength >= usd)
+                    xj = td * std::min( (ukd / tdLength) , float(1.0));
+
+                p1 += (w1 / totalWeight) * -xj;
+                p2 += (w2 / totalWeight) * xj;
+                c.friction -= xj;
+            }
+            c.dirty = false;
+            break;
+        }
+        case ContactConstraint::HALFSPACE:
+        {
+            if(p1 == c.qc)
+                return;
+            float C = QVector3D::dotProduct((p1 - c.qc), c.n);
+            if(C > 0)
+                return;
+            p1 += C * -c.n;
+            c.lambda -= C;
+            break;
+        }
+        case ContactConstraint::FRICTIONHALFSPACE:
+        {
+            if(!c.dirty)
+                return;
+
+            QVector3D dx = p1 - _particles.x[c.a];
+            QVector3D td = dx - QVector3D::dotProduct(dx, c.n) * c.n;
+            float tdLength = td.length();
+
+            float usd = 0.5;
+            float ukd = 0.5;
+
+            QVector3D xj = td;
+            if(tdLength >= usd)
+                xj = td * std::min( (ukd / tdLength) , float(1.0));
+            p1 += -xj;
+            c.friction -= xj;
+
+            c.dirty = false;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// pushes particles that already are inside a plane out, x and p alike
+void ContactArena::projectPreConditions(ParticleData &_particles)
+{
+    for(const ContactConstraint &c : m_preConditions)
+    {
+        QVector3D &x = _particles.x[c.a];
+        if(x == c.qc)
+            continue;
+
+        float C = QVector3D::dotProduct((x - c.qc), c.n);
+        x += C * -c.n;
+        _particles.p[c.a] += C * -c.n;
+    }
+}
@@ -0,0 +1,267 @@
+#include "dynamics/distanceKernel.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DISTANCEKERNEL_X86
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(QVector3D) == 3 * sizeof(float), "kernel reads QVector3D as three packed floats");
+
+DistanceKernel::Isa DistanceKernel::m_isa = DistanceKernel::SCALAR;
+bool DistanceKernel::m_detected = false;
+
+DistanceKernel::Isa DistanceKernel::detectIsa()
+{
+#ifdef DISTANCEKERNEL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SSE;
+#endif
+    return SCALAR;
+}
+
+DistanceKernel::Isa DistanceKernel::isa()
+{
+    if(!m_detected)
+    {
+        m_isa = detectIsa();
+        m_detected = true;
+    }
+    return m_isa;
+}
+
+void DistanceKernel::setIsa(Isa _isa)
+{
+    // never run code the cpu does not have
+    m_isa = std::min(_isa, detectIsa());
+    m_detected = true;
+}
+
+const char* DistanceKernel::isaName(Isa _isa)
+{
+    switch(_isa)
+    {
+        case AVX2:  return "avx2";
+        case SSE:   return "sse";
+        default:    return "scalar";
+    }
+}
+
+// same math as the vector paths, one lane at a time
+static void projectScalar(DistanceConstraintBatch &_batch, ParticleData &_particles,
+                          const int *_constraints, int _count)
+{
+    float *p = reinterpret_cast<float*>(_particles.p.data());
+    const float *w = _particles.w.data();
+
+    for(int i=0; i < _count; i++)
+    {
+        int c = _constraints[i];
+        int a = 3 * _batch.p1[c];
+        int b = 3 * _batch.p2[c];
+        float w1 = w[_batch.p1[c]];
+        float w2 = w[_batch.p2[c]];
+
+        float dx = p[a]     - p[b];
+        float dy = p[a + 1] - p[b + 1];
+        float dz = p[a + 2] - p[b + 2];
+        float len = std::sqrt(dx * dx + dy * dy + dz * dz);
+        float wSum = w1 + w2;
+        if(wSum <= 0 || len < 1e-6f)
+            continue;
+
+        float rest = _batch.restLength[c];
+        float res = (len > rest) ? _batch.stretch[c] : _batch.compress[c];
+        float alpha = _batch.compliance[c] * _batch.alphaScale;
+        float s = (len - rest + alpha * _batch.lambda[c]) * res / (len * (wSum + alpha));
+        _batch.lambda[c] -= s * len;
+
+        p[a]     -= w1 * s * dx;
+        p[a + 1] -= w1 * s * dy;
+        p[a + 2] -= w1 * s * dz;
+        p[b]     += w2 * s * dx;
+        p[b + 1] += w2 * s * dy;
+        p[b + 2] += w2 * s * dz;
+    }
+}
+
+#ifdef DISTANCEKERNEL_X86
+
+// four lanes with plain SSE2, particle data is loaded lane by lane
+static inline void projectSse4(DistanceConstraintBatch &_batch, float *p, const float *w, const int *_constraints)
+{
+    alignas(16) float ax[4], ay[4], az[4], bx[4], by[4], bz[4];
+    alignas(16) float w1[4], w2[4], rest[4], stretch[4], compress[4], alpha[4], lambda[4];
+    int a[4], b[4];
+
+    for(int l=0; l < 4; l++)
+    {
+        int c = _constraints[l];
+        a[l] = 3 * _batch.p1[c];
+        b[l] = 3 * _batch.p2[c];
+        ax[l] = p[a[l]]; ay[l] = p[a[l] + 1]; az[l] = p[a[l] + 2];
+        bx[l] = p[b[l]]; by[l] = p[b[l] + 1]; bz[l] = p[b[l] + 2];
+        w1[l] = w[_batch.p1[c]];
+        w2[l] = w[_batch.p2[c]];
+        rest[l] = _batch.restLength[c];
+        stretch[l] = _batch.stretch[c];
+        compress[l] = _batch.compress[c];
+        alpha[l] = _batch.compliance[c] * _batch.alphaScale;
+        lambda[l] = _batch.lambda[c];
+    }
+
+    __m128 vax = _mm_load_ps(ax), vay = _mm_load_ps(ay), vaz = _mm_load_ps(az);
+    __m128 vbx = _mm_load_ps(bx), vby = _mm_load_ps(by), vbz = _mm_load_ps(bz);
+    __m128 vw1 = _mm_load_ps(w1), vw2 = _mm_load_ps(w2);
+    __m128 vrest = _mm_load_ps(rest);
+
+    __m128 dx = _mm_sub_ps(vax, vbx);
+    __m128 dy = _mm_sub_ps(vay, vby);
+    __m128 dz = _mm_sub_ps(vaz, vbz);
+    __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    __m128 wSum = _mm_add_ps(vw1, vw2);
+
+    __m128 valid = _mm_and_ps(_mm_cmpgt_ps(wSum, _mm_setzero_ps()),
+                              _mm_cmpge_ps(len, _mm_set1_ps(1e-6f)));
+    __m128 stretching = _mm_cmpgt_ps(len, vrest);
+    __m128 res = _mm_or_ps(_mm_and_ps(stretching, _mm_load_ps(stretch)),
+                           _mm_andnot_ps(stretching, _mm_load_ps(compress)));
+
+    __m128 valpha = _mm_load_ps(alpha);
+    __m128 c = _mm_add_ps(_mm_sub_ps(len, vrest), _mm_mul_ps(valpha, _mm_load_ps(lambda)));
+    __m128 s = _mm_div_ps(_mm_mul_ps(c, res), _mm_mul_ps(len, _mm_add_ps(wSum, valpha)));
+    s = _mm_and_ps(valid, s);
+    _mm_store_ps(lambda, _mm_mul_ps(s, len));
+    __m128 s1 = _mm_mul_ps(vw1, s);
+    __m128 s2 = _mm_mul_ps(vw2, s);
+
+    _mm_store_ps(ax, _mm_sub_ps(vax, _mm_mul_ps(s1, dx)));
+    _mm_store_ps(ay, _mm_sub_ps(vay, _mm_mul_ps(s1, dy)));
+    _mm_store_ps(az, _mm_sub_ps(vaz, _mm_mul_ps(s1, dz)));
+    _mm_store_ps(bx, _mm_add_ps(vbx, _mm_mul_ps(s2, dx)));
+    _mm_store_ps(by, _mm_add_ps(vby, _mm_mul_ps(s2, dy)));
+    _mm_store_ps(bz, _mm_add_ps(vbz, _mm_mul_ps(s2, dz)));
+
+    for(int l=0; l < 4; l++)
+    {
+        p[a[l]] = ax[l]; p[a[l] + 1] = ay[l]; p[a[l] + 2] = az[l];
+        p[b[l]] = bx[l]; p[b[l] + 1] = by[l]; p[b[l] + 2] = bz[l];
+        _batch.lambda[_constraints[l]] -= lambda[l];
+    }
+}
+
+static void projectSse(DistanceConstraintBatch &_batch, ParticleData &_particles,
+                       const int *_constraints, int _count)
+{
+    float *p = reinterpret_cast<float*>(_particles.p.data());
+    const float *w = _particles.w.data();
+
+    int i = 0;
+    for(; i + DistanceKernel::width <= _count; i += DistanceKernel::width)
+    {
+        projectSse4(_batch, p, w, _constraints + i);
+        projectSse4(_batch, p, w, _constraints + i + 4);
+    }
+    projectScalar(_batch, _particles, _constraints + i, _count - i);
+}
+
+// eight lanes, indices and particle data come in with gathers
+__attribute__((target("avx2")))
+static void projectAvx2(DistanceConstraintBatch &_batch, ParticleData &_particles,
+                        const int *_constraints, int _count)
+{
+    float *p = reinterpret_cast<float*>(_particles.p.data());
+    const float *w = _particles.w.data();
+    const int *p1 = _batch.p1.data();
+    const int *p2 = _batch.p2.data();
+
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i one = _mm256_set1_epi32(1);
+    alignas(32) int a[8], b[8];
+    alignas(32) float ax[8], ay[8], az[8], bx[8], by[8], bz[8], dLambda[8];
+    const __m256 alphaScale = _mm256_set1_ps(_batch.alphaScale);
+
+    int i = 0;
+    for(; i + DistanceKernel::width <= _count; i += DistanceKernel::width)
+    {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_constraints + i));
+        __m256i i1 = _mm256_i32gather_epi32(p1, c, 4);
+        __m256i i2 = _mm256_i32gather_epi32(p2, c, 4);
+        __m256i va = _mm256_mullo_epi32(i1, three);
+        __m256i vb = _mm256_mullo_epi32(i2, three);
+
+        __m256 vax = _mm256_i32gather_ps(p, va, 4);
+        __m256 vay = _mm256_i32gather_ps(p, _mm256_add_epi32(va, one), 4);
+        __m256 vaz = _mm256_i32gather_ps(p + 2, va, 4);
+        __m256 vbx = _mm256_i32gather_ps(p, vb, 4);
+        __m256 vby = _mm256_i32gather_ps(p, _mm256_add_epi32(vb, one), 4);
+        __m256 vbz = _mm256_i32gather_ps(p + 2, vb, 4);
+        __m256 vw1 = _mm256_i32gather_ps(w, i1, 4);
+        __m256 vw2 = _mm256_i32gather_ps(w, i2, 4);
+        __m256 vrest = _mm256_i32gather_ps(_batch.restLength.data(), c, 4);
+        __m256 vstretch = _mm256_i32gather_ps(_batch.stretch.data(), c, 4);
+        __m256 vcompress = _mm256_i32gather_ps(_batch.compress.data(), c, 4);
+        __m256 valpha = _mm256_mul_ps(_mm256_i32gather_ps(_batch.compliance.data(), c, 4), alphaScale);
+        __m256 vlambda = _mm256_i32gather_ps(_batch.lambda.data(), c, 4);
+
+        __m256 dx = _mm256_sub_ps(vax, vbx);
+        __m256 dy = _mm256_sub_ps(vay, vby);
+        __m256 dz = _mm256_sub_ps(vaz, vbz);
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+        __m256 wSum = _mm256_add_ps(vw1, vw2);
+
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(wSum, _mm256_setzero_ps(), _CMP_GT_OQ),
+                                     _mm256_cmp_ps(len, _mm256_set1_ps(1e-6f), _CMP_GE_OQ));
+        __m256 res = _mm256_blendv_ps(vcompress, vstretch, _mm256_cmp_ps(len, vrest, _CMP_GT_OQ));
+
+        __m256 C = _mm256_add_ps(_mm256_sub_ps(len, vrest), _mm256_mul_ps(valpha, vlambda));
+        __m256 s = _mm256_div_ps(_mm256_mul_ps(C, res), _mm256_mul_ps(len, _mm256_add_ps(wSum, valpha)));
+        s = _mm256_and_ps(valid, s);
+        _mm256_store_ps(dLambda, _mm256_mul_ps(s, len));
+        __m256 s1 = _mm256_mul_ps(vw1, s);
+        __m256 s2 = _mm256_mul_ps(vw2, s);
+
+        // no scatter in avx2, write the lanes back one by one
+        _mm256_store_si256(reinterpret_cast<__m256i*>(a), va);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(b), vb);
+        _mm256_store_ps(ax, _mm256_sub_ps(vax, _mm256_mul_ps(s1, dx)));
+        _mm256_store_ps(ay, _mm256_sub_ps(vay, _mm256_mul_ps(s1, dy)));
+        _mm256_store_ps(az, _mm256_sub_ps(vaz, _mm256_mul_ps(s1, dz)));
+        _mm256_store_ps(bx, _mm256_add_ps(vbx, _mm256_mul_ps(s2, dx)));
+        _mm256_store_ps(by, _mm256_add_ps(vby, _mm256_mul_ps(s2, dy)));
+        _mm256_store_ps(bz, _mm256_add_ps(vbz, _mm256_mul_ps(s2, dz)));
+
+        for(int l=0; l < 8; l++)
+        {
+            p[a[l]] = ax[l]; p[a[l] + 1] = ay[l]; p[a[l] + 2] = az[l];
+            p[b[l]] = bx[l]; p[b[l] + 1] = by[l]; p[b[l] + 2] = bz[l];
+            _batch.lambda[_constraints[i + l]] -= dLambda[l];
+        }
+    }
+    projectScalar(_batch, _particles, _constraints + i, _count - i);
+}
+
+#endif // DISTANCEKERNEL_X86
+
+void DistanceKernel::project(DistanceConstraintBatch &_batch, ParticleData &_particles,
+                             const int *_constraints, int _count)
+{
+    switch(isa())
+    {
+#ifdef DISTANCEKERNEL_X86
+        case AVX2:
+            projectAvx2(_batch, _particles, _constraints, _count);
+            break;
+        case SSE:
+            projectSse(_batch, _particles, _constraints, _count);
+            break;
+#endif
+        default:
+            projectScalar(_batch, _particles, _constraints, _count);
+            break;
+    }
+}
@@ -0,0 +1,72 @@
+#include "dynamics/dynamicsThread.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "dynamics/dynamicsWorld.h"
+
+// longest nap between two looks at the command queue, so pins follow the
+// mouse while the world is paused or steps are long
+static const double maxWait = 0.004;
+
+DynamicsThread::DynamicsThread(DynamicsWorld *_world)
+    : m_world(_world),
+      m_running(false),
+      m_steps(0)
+{
+
+}
+
+DynamicsThread::~DynamicsThread()
+{
+    stop();
+}
+
+void DynamicsThread::start()
+{
+    if(m_running)
+        return;
+    m_running = true;
+    m_thread = std::thread(&DynamicsThread::run, this);
+}
+
+void DynamicsThread::stop()
+{
+    if(!m_running)
+        return;
+    m_running = false;
+    m_thread.join();
+}
+
+std::unique_lock<std::mutex> DynamicsThread::pause()
+{
+    return std::unique_lock<std::mutex>(m_mutex);
+}
+
+int DynamicsThread::takeSteps()
+{
+    return m_steps.exchange(0);
+}
+
+// the time spent paused is handed to the clock as well, which drops what
+// it can't catch up on
+void DynamicsThread::run()
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point last = Clock::now();
+
+    while(m_running)
+    {
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        double wait;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_steps += m_world->advance(seconds);
+            wait = m_world->timeToNextStep();
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(std::min(wait, maxWait)));
+    }
+}
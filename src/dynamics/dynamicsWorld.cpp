@@ -1,18 +1,17 @@
 
 #include <stdio.h>
+#include <algorithm>
+#include <chrono>
 
 #include "dynamics/dynamicsWorld.h"
 
-#include "Scene.h"
-
-#include <Qdebug>
+#include <QDebug>
+#include <QElapsedTimer>
 
 #include <omp.h>
 
 #include "parameters.h"
 
-Eigen::Matrix3f QMatrix3toEigen(const QMatrix3x3 &_qMat);
-QMatrix3x3 EigenMatrix3toQt(const Eigen::Matrix3f &_eMat);
 
 
 DynamicsWorld::DynamicsWorld()
@@ -29,7 +28,20 @@ DynamicsWorld::DynamicsWorld()
 
     m_preConditionIteration = preConditionIterations;
     m_constraintIteration = constraintIterations;
+    m_substeps = substeps;
     m_pbdDamping = pbd_Damping;
+    m_solverType = SolverType(solverType);
+    m_overRelaxation = jacobiOverRelaxation;
+    m_contactWarmStart = contactWarmStart;
+    m_sleeping = islandSleeping;
+    m_clock.setMaxSteps(maxStepsPerFrame);
+    m_sleepVelocity = sleepVelocity;
+    m_sleepFrames = sleepFrames;
+    m_DistanceConstraintStretch = distanceConstraintStrechR;
+    m_distanceConstraintCompress = distanceConstraintCompressR;
+    m_distanceConstraintCompliance = distanceConstraintCompliance;
+    m_shapeMatchingCompliance = shapeMatchingCompliance;
+    m_bendingCompliance = bendingCompliance;
 }
 
 void DynamicsWorld::initialize()
@@ -68,527 +80,850 @@ void DynamicsWorld::initialize()
 //    addPlane(nZ);
 
 //    auto nSpring = std::make_shared<DistanceEqualityConstraint>(m_Particles[0], m_Particles[1]);
-    for( ParticlePtr p : m_Particles)
-    {
-        p->pp = QVector3D(0,0,0);
-    }
 }
 
-void DynamicsWorld::initialize(Scene *_scene)
+void DynamicsWorld::initialize(DynamicsWorldListener *_listener)
 {
-    m_scene = _scene;
+    m_listener = _listener;
     initialize();
 }
 
 void DynamicsWorld::update()
 {
     float dt = m_dt;
+    ParticleData &pd = m_particleData;
 
+    processCommands();
     if(!m_simulate)
         return;
+    m_islands.resize(int(pd.size()));
 //    mlog<<" ---------------void DynamicsWorld::update()----------------";
 
-    // PBD Loop start
-    // explicit Euler integration step (5)
-
+    m_timings = PhaseTimings();
+    m_phaseTimer.start();
+    m_phaseStart = 0;
 
-    for( ParticlePtr p : m_Particles)
+    if(m_substeps > 1)
     {
-        // e.G. gravity 0, 1, 0
-//        QVector3D forceExt = QVector3D(0, -9.8, 0);
-        QVector3D forceExt  = m_gravity;
-        p->v = p->v + dt * p->w * forceExt;
-
-        if(isnan(p->v.x()) || isnan(p->v.y()) || isnan(p->v.z())){
-        }
+        updateSubsteps();
+        return;
     }
 
+    // PBD Loop start
+    // explicit Euler integration step (5)
+    integrate(dt);
+    m_timings.integration += lap();
+
     // damp Velocities (6)
     pbdDamping();
+    m_timings.damping += lap();
 
-    for( ParticlePtr p : m_Particles)
-    {
-        p->p = p->x + dt * p->v;
-    }
+    predict(dt);
+    m_timings.integration += lap();
 
+    // woken islands join the coloring of this frame
     collisionCheckAll();
+    wakeTouchedIslands();
+    colorConstraints();
+    m_timings.broadPhase += lap();
 
-    // Constraint dirty to do something
-    for( ParticlePtr p : m_Particles)
-    {
-        for( ConstraintWeakPtr c : p->m_Constraints){
-            if(auto constraint = c.lock()){
-                constraint->setDirty(true);
-            }
-        }
-    }
+    m_contactArena.warmStart(pd, m_contactWarmStart);
 
     // Preconditioning (solve particle plane cstrs once)
     for(int i=0; i < m_preConditionIteration; i++)
     {
-        for( ParticlePtr p : m_Particles)
-        {
-            for( ConstraintPtr c : p->m_PreConditionConstraints)
-            {
-                c->project();
-            }
-
-        }
+        m_contactArena.projectPreConditions(pd);
     }
+    m_timings.preConditioning += lap();
     m_frameCount++;
 
+    resetMultipliers(dt);
+
     // Solver Iteration (9)
-    int nthreads, tid, test;
     for(int i=0; i<m_constraintIteration; i++)
     {
-//        #pragma omp parallel for
-        for(int j=0; j < m_Particles.size(); j++)
-        {
-    //        for( ConstraintWeakPtr c : p->m_Constraints)
-            auto p = m_Particles[j];
+        projectConstraints();
+        projectCollisionConstraints();
+    }
 
-            for( ConstraintWeakPtr c : p->m_Constraints)
-            {
-                if(auto constraint = c.lock()){
-                    {
-                        constraint->project();
-                    }
-                }
-            }
-        }
+    //delte collisions, keep their corrections for the next frame
+    m_contactArena.updateCache();
+    m_contactArena.clear();
+    m_timings.solve += lap();
+
+    // Apply correction (13,14)
+    updateVelocities(dt, restDistance);
+    updateIslands();
+    m_damping.updateSleeping(pd);
+    m_timings.velocityUpdate += lap();
 
-        for( ParticlePtr p : m_Particles)
+
+    //     modify velocity (16)
+    //    for( ParticlePtr p : m_Particles)
+    //    {
+    //        p->v = p->v + p->pp;
+    //        p->pp = QVector3D(0,0,0);
+    //    }
+
+
+}
+
+// steps the world by as many fixed steps as fit into _seconds of real time
+// and publishes them to be drawn in between the last two
+int DynamicsWorld::advance(double _seconds)
+{
+    if(!m_simulate)
+    {
+        processCommands();
+        publish(1);
+        return 0;
+    }
+
+    m_clock.setStepSize(m_dt);
+    int steps = m_clock.advance(_seconds);
+    for(int i=0; i < steps; i++)
+    {
+        if(i == steps - 1)
         {
-            for( ConstraintWeakPtr c : p->m_Constraints)
+            m_previousX.assign(m_particleData.x.begin(), m_particleData.x.end());
+            for(auto &c : m_ShapeMatchingConstraints)
             {
-                if(auto constraint = c.lock()){
-                    {
-                        constraint->setDirty(true);
-                    }
-                }
+                if(RigidBodyGrid *body = c->body())
+                    body->keepPreviousTransform();
             }
+        }
+        update();
+    }
 
-            for( ConstraintPtr c : p->m_CollisionConstraints)
-            {
-                c->project();
-//                c->setDirty(true);
-            }
+    publish(m_clock.alpha());
+    return steps;
+}
+
+double DynamicsWorld::timeToNextStep() const
+{
+    return m_simulate ? m_clock.timeToNextStep() : m_clock.stepSize();
+}
+
+static double steadySeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// copies what the renderer needs into the back snapshot. Particles added
+// since the last step have no previous position and are drawn where they are.
+void DynamicsWorld::publish(float _alpha)
+{
+    WorldSnapshot &snapshot = m_snapshots.back();
+    snapshot.x.assign(m_particleData.x.begin(), m_particleData.x.end());
+    if(_alpha < 1)
+        snapshot.previous.assign(m_previousX.begin(), m_previousX.end());
+    else
+        snapshot.previous.clear();
+    snapshot.colliders.assign(m_nonUniformParticleData.x.begin(), m_nonUniformParticleData.x.end());
+    snapshot.radii.assign(m_particleData.r.begin(), m_particleData.r.end());
+    snapshot.colliderRadii.assign(m_nonUniformParticleData.r.begin(), m_nonUniformParticleData.r.end());
+
+    // bodies added in the last step are drawn where they are
+    snapshot.bodies.clear();
+    snapshot.transforms.clear();
+    snapshot.previousTransforms.clear();
+    for(auto &c : m_ShapeMatchingConstraints)
+    {
+        if(RigidBodyGrid *body = c->body())
+        {
+            snapshot.bodies.push_back(body);
+            snapshot.transforms.push_back(body->transform());
+            if(_alpha < 1)
+                snapshot.previousTransforms.push_back(body->hasPreviousTransform() ? body->previousTransform()
+                                                                                 : body->transform());
         }
     }
 
-    //delte collisions
-    for( ParticlePtr p : m_Particles)
+    if(snapshot.linesVersion != m_distanceVersion)
     {
-        p->m_CollisionConstraints.clear();
-        p->m_PreConditionConstraints.clear();
+        const DistanceConstraintBatch &distance = m_DistanceConstraints;
+        snapshot.lines.resize(2 * distance.size());
+        for(size_t i=0; i < distance.size(); i++)
+        {
+            snapshot.lines[2 * i] = distance.p1[i];
+            snapshot.lines[2 * i + 1] = distance.p2[i];
+        }
+        snapshot.linesVersion = m_distanceVersion;
     }
 
+    snapshot.alpha = _alpha;
+    snapshot.stepSize = m_clock.stepSize();
+    snapshot.time = steadySeconds();
+    snapshot.frame = m_frameCount;
+    m_snapshots.publish();
+}
 
+// rotation and translation of a rigid transform, the rotation by slerp
+static QMatrix4x4 blendTransform(const QMatrix4x4 &_a, const QMatrix4x4 &_b, float _t)
+{
+    Eigen::Matrix3f ra, rb;
+    for(int r=0; r < 3; r++)
+        for(int c=0; c < 3; c++)
+        {
+            ra(r,c) = _a(r,c);
+            rb(r,c) = _b(r,c);
+        }
+    Eigen::Matrix3f rot = Eigen::Quaternionf(ra).slerp(_t, Eigen::Quaternionf(rb)).toRotationMatrix();
 
-    // Apply correction (13,14)
-    for( ParticlePtr p : m_Particles)
+    QMatrix4x4 m;
+    for(int r=0; r < 3; r++)
     {
-        QVector3D xp = (p->p - p->x);
+        for(int c=0; c < 3; c++)
+            m(r,c) = rot(r,c);
+        m(r,3) = _a(r,3) + _t * (_b(r,3) - _a(r,3));
+    }
+    return m;
+}
 
-        // sleep
-        if(xp.length() < 0.003){
-            p->v = QVector3D(0,0,0);
-            continue;
-        }
+// render thread: takes the newest snapshot and blends it by its alpha plus
+// the real time passed since, the world may have run on meanwhile
+void DynamicsWorld::present()
+{
+    std::function<void()> task;
+    while(m_renderTasks.pop(task))
+    {
+        task();
+    }
 
-        p->v = xp / dt;
-        p->x = p->p;
+    m_snapshots.acquire();
+    const WorldSnapshot &snapshot = m_snapshots.front();
 
-    }
+    float alpha = 1;
+    if(!snapshot.previous.empty() && snapshot.stepSize > 0)
+        alpha = float(std::min(1.0, snapshot.alpha + (steadySeconds() - snapshot.time) / snapshot.stepSize));
 
-    for( ParticlePtr p : m_NonUniformParticles)
+    int numParticles = int(snapshot.x.size());
+    int numPrevious = alpha < 1 ? std::min(numParticles, int(snapshot.previous.size())) : 0;
+    AlignedVector<QVector3D> &xRender = m_particleData.xRender;
+    xRender.resize(numParticles);
+
+    #pragma omp parallel for
+    for(int i=0; i < numParticles; i++)
     {
-        for(auto c : p->m_Constraints)
-        {
-            if(auto constraint = c.lock())
-                constraint->project();
-        }
-        p->x = p->p;
+        if(i < numPrevious)
+            xRender[i] = snapshot.previous[i] + alpha * (snapshot.x[i] - snapshot.previous[i]);
+        else
+            xRender[i] = snapshot.x[i];
     }
 
+    // colliders follow the user and are drawn where they are
+    m_nonUniformParticleData.xRender.assign(snapshot.colliders.begin(), snapshot.colliders.end());
+    m_particleData.rRender.assign(snapshot.radii.begin(), snapshot.radii.end());
+    m_nonUniformParticleData.rRender.assign(snapshot.colliderRadii.begin(), snapshot.colliderRadii.end());
 
-    //     modify velocity (16)
-    //    for( ParticlePtr p : m_Particles)
-    //    {
-    //        p->v = p->v + p->pp;
-    //        p->pp = QVector3D(0,0,0);
-    //    }
+    bool blendBodies = alpha < 1 && snapshot.previousTransforms.size() == snapshot.bodies.size();
+    for(size_t i=0; i < snapshot.bodies.size(); i++)
+    {
+        if(blendBodies)
+            snapshot.bodies[i]->setRenderTransform(blendTransform(snapshot.previousTransforms[i], snapshot.transforms[i], alpha));
+        else
+            snapshot.bodies[i]->setRenderTransform(snapshot.transforms[i]);
+    }
 
+    if(m_debugLinesVersion != snapshot.linesVersion)
+    {
+        m_debugLines = snapshot.lines;
+        m_debugLinesVersion = snapshot.linesVersion;
+    }
 
+    m_renderAlpha = alpha;
+    m_presentedFrame = snapshot.frame;
 }
 
-void DynamicsWorld::info()
+float DynamicsWorld::interpolationAlpha() const
 {
-    qDebug()<<"p1: "<<m_Particles[0]->x<<m_Particles[0]->ID<<m_Particles[0]->r;
+    return m_renderAlpha;
 }
 
-DynamicsWorldController* DynamicsWorld::controller()
+int DynamicsWorld::presentedFrame() const
 {
-    if(m_DynamicsWorldController)
-        return m_DynamicsWorldController;
-    return nullptr;
+    return m_presentedFrame;
 }
 
-void DynamicsWorld::setSimulate(bool _isSimulating)
+// any thread, the world runs the commands in order at its next step
+void DynamicsWorld::post(const Command &_command)
 {
-    m_simulate = _isSimulating;
+    m_commands.push(_command);
 }
 
-void DynamicsWorld::setAllParticlesMass(float _m)
+// simulation thread. A replayed command runs before the frame it was
+// recorded at, a command may post or step itself.
+void DynamicsWorld::processCommands()
 {
-    for(auto p : m_Particles)
+    while(m_replayNext < m_replay.size() && m_replay[m_replayNext].frame <= m_frameCount)
     {
-        if(p->mass() <= 0.001)
-            continue;
-        p->setMass(_m);
+        m_replay[m_replayNext++].command(*this);
+    }
+
+    Command command;
+    while(m_commands.pop(command))
+    {
+        if(m_recording)
+            m_recordedCommands.push_back(RecordedCommand{m_frameCount, command});
+        command(*this);
     }
 }
 
-void DynamicsWorld::setAllDistanceConstraintStretch(float _globalStretch)
+void DynamicsWorld::setRecording(bool _recording)
 {
-//    for(auto c : m_Constraints)
+    if(_recording && !m_recording)
+        m_recordedCommands.clear();
+    m_recording = _recording;
 }
 
-void DynamicsWorld::setAllDistanceConstraintCompress(float _globalCompress)
+const std::vector<DynamicsWorld::RecordedCommand> &DynamicsWorld::recordedCommands() const
 {
+    return m_recordedCommands;
+}
 
+void DynamicsWorld::replay(const std::vector<RecordedCommand> &_commands)
+{
+    m_replay = _commands;
+    m_replayNext = 0;
 }
 
-void DynamicsWorld::step()
+// scene objects belong to the render thread, what a command does to them
+// waits for the next present()
+void DynamicsWorld::postToRenderer(const std::function<void()> &_task)
 {
-    m_simulate = true;
-    update();
-    m_simulate = false;
+    m_renderTasks.push(_task);
 }
 
-int DynamicsWorld::getTimeStepSizeMS()
+void DynamicsWorld::setMaxStepsPerFrame(int _maxSteps)
 {
-    return m_dt * 1000;
+    m_clock.setMaxSteps(_maxSteps);
 }
 
-void DynamicsWorld::pbdDamping()
+// Small steps (Macklin et al. 2019): the frame is cut into m_substeps steps
+// of one solver iteration each. The hash grid is queried once per frame with
+// the contact radius inflated by how far particles can travel in the frame,
+// every substep only tests these candidates against its own positions.
+void DynamicsWorld::updateSubsteps()
 {
-    int i = 0;
-    for(auto dObject : m_DynamicObjects)
+    ParticleData &pd = m_particleData;
+    float h = m_dt / m_substeps;
+
+    pbdDamping();
+    m_timings.damping += lap();
+
+    m_frameStart.assign(pd.x.begin(), pd.x.end());
+    predict(m_dt);
+    m_contactMargin = contactMargin(m_dt);
+    findContacts();
+    m_contactMargin = 0;
+    m_contactCandidates.swap(m_contacts);
+    m_contacts.clear();
+    // candidates already wake what the frame could touch
+    m_contacts.insert(m_contacts.end(), m_contactCandidates.begin(), m_contactCandidates.end());
+    wakeTouchedIslands();
+    colorConstraints();
+    m_timings.broadPhase += lap();
+
+    for(int s=0; s < m_substeps; s++)
     {
-        i++;
-        QVector3D xcm, vcm, ri, L, w;
-        QMatrix3x3 I;
-        float totalMass = 0;
+        integrate(h);
+        predict(h);
+        m_timings.integration += lap();
 
-        if(dObject->numParticles() < 1)
-            continue;
+        m_contacts.clear();
+        for(const ParticleContact &c : m_contactCandidates)
+        {
+            if(c.type == ParticleContact::PLANE)
+                checkSpherePlane(c.a, c.b, m_contacts);
+            else if(c.type == ParticleContact::TRIANGLE)
+                checkSphereTriangle(c.a, c.b, m_contacts);
+            else if(c.type == ParticleContact::SDF)
+                checkSphereSdf(c.a, c.b, m_contacts);
+            else if(c.type == ParticleContact::COLLIDER)
+                checkSphereSphere(c.a, m_nonUniformParticleData, c.b, c.type, m_contacts);
+            else
+                checkSphereSphere(c.a, pd, c.b, c.type, m_contacts);
+        }
+        emitContacts();
+        m_timings.broadPhase += lap();
 
-        for(auto p : dObject->getParticles())
+        m_contactArena.warmStart(pd, m_contactWarmStart);
+        for(int i=0; i < m_preConditionIteration; i++)
         {
-            if(auto particle = p.lock())
-            {
-                xcm += particle->m * particle->x;
-                vcm += particle->m * particle->v;
-                totalMass += particle->m;
-            }
+            m_contactArena.projectPreConditions(pd);
         }
+        m_timings.preConditioning += lap();
 
-        if(totalMass <= 0.001)
-            return;
+        resetMultipliers(h);
+        projectConstraints();
+        projectCollisionConstraints();
+        m_contactArena.updateCache();
+        m_contactArena.clear();
+        m_timings.solve += lap();
 
-        xcm /= totalMass;
-        vcm /= totalMass;
+        updateVelocities(h, 0);
+        m_timings.velocityUpdate += lap();
+    }
+    m_frameCount++;
 
-        for(auto p : dObject->getParticles())
-        {
-            if(auto particle = p.lock())
-            {
-                ri = particle->x - xcm;
-                L += QVector3D::crossProduct(ri, (particle->m * particle->v));
-                QMatrix3x3 rt;
-                rt(0,0) =            0 ; rt(0,1) =       -ri[2] ; rt(0,2) =        ri[1] ;
-                rt(1,0) =         ri[2]; rt(1,1) =            0 ; rt(1,2) =       -ri[0] ;
-                rt(2,0) =        -ri[1]; rt(2,1) =        ri[0] ; rt(2,2) =            0 ;
-
-                Eigen::Matrix3f rtMat = QMatrix3toEigen(rt);
-                Eigen::Matrix3f IMat = rtMat * rtMat.transpose() * particle->m;
-                I += EigenMatrix3toQt(IMat);
-            }
-        }
-        Eigen::Vector3f wM = QMatrix3toEigen(I).inverse() * Eigen::Vector3f(L.x(), L.y(), L.z());
-        w = QVector3D(wM.x(), wM.y(), wM.z());
+    // the rest test of a single step on the velocity the frame ends with,
+    // a substep moves too little to ever pass it. Only the velocity is
+    // stopped, the corrections of the frame are kept.
+    int numParticles = int(pd.size());
+    #pragma omp parallel for
+    for(int i=0; i < numParticles; i++)
+    {
+        if(pd.v[i].length() * m_dt < restDistance)
+            pd.v[i] = QVector3D(0,0,0);
+    }
 
-        int i = 0;
-        for(auto p : dObject->getParticles())
-        {
-            if(auto particle = p.lock())
-            {
-                ri = particle->x - xcm;
-                QVector3D dv = vcm + (QVector3D::crossProduct(w, ri)) - particle->v;
-                i++;
-                particle->v +=  (m_pbdDamping * dv);
-            }
-        }
+    updateIslands();
+    m_damping.updateSleeping(pd);
+    m_timings.velocityUpdate += lap();
+}
+
+// milliseconds since the previous lap
+double DynamicsWorld::lap()
+{
+    qint64 now = m_phaseTimer.nsecsElapsed();
+    double ms = double(now - m_phaseStart) * 1e-6;
+    m_phaseStart = now;
+    return ms;
+}
+
+void DynamicsWorld::integrate(float _dt)
+{
+    ParticleData &pd = m_particleData;
+    const SimulationIslands &islands = m_islands;
+    int numParticles = int(pd.size());
+
+    // e.G. gravity 0, 1, 0
+    QVector3D forceExt  = m_gravity;
+    #pragma omp parallel for
+    for(int i=0; i < numParticles; i++)
+    {
+        if(islands.asleep(i))
+            continue;
+        pd.v[i] = pd.v[i] + _dt * pd.w[i] * forceExt;
     }
 }
 
-void DynamicsWorld::compare(ParticlePtr _a)
+void DynamicsWorld::predict(float _dt)
 {
-    mlog<<"compare";
+    ParticleData &pd = m_particleData;
+    int numParticles = int(pd.size());
+
+    #pragma omp parallel for
+    for(int i=0; i < numParticles; i++)
+    {
+        pd.p[i] = pd.x[i] + _dt * pd.v[i];
+    }
 }
 
-/*
- *
- * from https://stackoverflow.com/questions/2047414/advantages-of-stdfor-each-over-for-loop
- *
- * for_each(a.begin(), a.end(), a_item_handler);
-is better than
+// a particle that moved less than _rest counts as resting, its velocity
+// is dropped
+void DynamicsWorld::updateVelocities(float _dt, float _rest)
+{
+    ParticleData &pd = m_particleData;
+    const SimulationIslands &islands = m_islands;
+    int numParticles = int(pd.size());
 
-for(auto& item: a) {
-    a_item_handler(a);
+    #pragma omp parallel for
+    for(int i=0; i < numParticles; i++)
+    {
+        if(islands.asleep(i))
+            continue;
+
+        QVector3D xp = (pd.p[i] - pd.x[i]);
+
+        // sleep
+        if(xp.length() < _rest){
+            pd.v[i] = QVector3D(0,0,0);
+            continue;
+        }
+
+        pd.v[i] = xp / _dt;
+        pd.x[i] = pd.p[i];
+    }
+
+    // colliders only move by their pins, projected with the other constraints
+    for( ParticlePtr p : m_NonUniformParticles)
+    {
+        p->x() = p->p();
+    }
 }
-*/
 
-void DynamicsWorld::addDynamicObject(pSceneOb _sceneObject)
+// how far two particles can close in on each other within _dt, capped by
+// the one cell the neighbourhood search reaches
+float DynamicsWorld::contactMargin(float _dt)
 {
+    const ParticleData &pd = m_particleData;
+    int numParticles = int(pd.size());
+
+    float maxSpeed = 0;
+    #pragma omp parallel for reduction(max:maxSpeed)
+    for(int i=0; i < numParticles; i++)
+    {
+        maxSpeed = std::max(maxSpeed, pd.v[i].length());
+    }
 
+    float travel = (maxSpeed + m_gravity.length() * _dt) * _dt;
+    return std::min(2.0f * travel, 1.0f / m_hashGrid.getGridSize());
 }
 
-DynamicObjectPtr DynamicsWorld::addDynamicObjectAsParticle(pSceneOb _sceneObject)
+void DynamicsWorld::projectConstraints()
 {
-    pCount++;
-    QVector3D pos = _sceneObject->getPos();
-    auto pParticle = std::make_shared<Particle>(pos.x(), pos.y(), pos.z(), pCount);
-    pParticle->ID = pCount;
-    pParticle->bodyID = pCount;
-    pParticle->setRadius(_sceneObject->getRadius());
-//    pParticle->setMass(0);
-    mlog<<"New Particle: "<<pParticle->w<<" ID: "<<pParticle->ID ;
-    m_Particles.push_back(pParticle);
-//    SingleParticle pDynamicObject(pParticle);
-    std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(pParticle);
-    pDynamicObject->mID = pCount;
-    m_DynamicObjects.push_back(pDynamicObject);
-    _sceneObject->makeDynamic(pDynamicObject);
-    // std::move (?)
-    return pDynamicObject;
+    if(m_solverType == JACOBI)
+    {
+        projectConstraintsJacobi();
+    }
+    else
+    {
+        projectDistanceConstraints();
+
+        auto &shapeMatching = m_ShapeMatchingConstraints;
+        m_ShapeMatchingScheduler.project([&](int i){ shapeMatching[i]->project(); });
+    }
+
+    for(auto &c : m_PinTogetherConstraints)
+        c->project();
+
+    // pins last, they override whatever the other constraints did
+    for(auto &c : m_PinConstraints)
+        c->project();
 }
 
-DynamicObjectPtr DynamicsWorld::addDynamicObjectAsRigidBody(pSceneOb _sceneObject, int color)
+// every color is cut into blocks for the threads, each block runs through
+// the SIMD kernel eight constraints at a time
+void DynamicsWorld::projectDistanceConstraints()
 {
-    if(!_sceneObject->model())
-        return nullptr;
+    const int blockSize = 256;
+    ParticleData &pd = m_particleData;
+    DistanceConstraintBatch &distance = m_DistanceConstraints;
+    DistanceKernel::isa();
 
-    // clones it's own model object with all data. (cause model will me deformed)
-    auto nRB = std::make_shared<RigidBody>(_sceneObject->model());
-    objectCount++;
-    ModelPtr model = nRB->getModel();
-    _sceneObject->setModel(nRB->getModel());
+    for(int c=0; c < m_DistanceColoring.numColors(); c++)
+    {
+        const std::vector<int> &color = m_DistanceColoring.color(c);
+        int n = int(color.size());
+        int numBlocks = (n + blockSize - 1) / blockSize;
+
+        #pragma omp parallel for if(numBlocks > 1)
+        for(int b=0; b < numBlocks; b++)
+        {
+            int start = b * blockSize;
+            DistanceKernel::project(distance, pd, color.data() + start, std::min(blockSize, n - start));
+        }
+    }
+
+    for(int i : m_DistanceColoring.sequential())
+    {
+        distance.project(pd, i);
+    }
+}
+
+// distance and shape matching constraints all project from the same p,
+// their averaged corrections are applied once at the end
+void DynamicsWorld::projectConstraintsJacobi()
+{
+    ParticleData &pd = m_particleData;
+    m_jacobiSolver.resize(int(pd.size()));
+
+    int numDistance = int(m_DistanceConstraints.size());
+    int numShapeMatching = int(m_ShapeMatchingConstraints.size());
 
-    for(unsigned int i = 0; i < model->getNumShapes(); i++)
+    #pragma omp parallel
     {
-        ShapePtr shape = model->getShape(i);
-        for(auto point : shape->getPoints())
+        int tid = omp_get_thread_num();
+
+        #pragma omp for nowait
+        for(int i=0; i < numDistance; i++)
         {
-            QVector3D pos = _sceneObject->getMatrix() * point;
-            pCount++;
-            auto nParticle = std::make_shared<Particle>(pos.x(), pos.y(), pos.z(), 33);
-            nParticle->ID = pCount;
-            nParticle->bodyID = objectCount;
-            nParticle->setRadius(_sceneObject->getRadius());
+            if(m_islands.asleep(m_DistanceConstraints.p1[i]))
+                continue;
 
-            nParticle->setMass(0.1);
+            QVector3D d1, d2;
+            if(m_DistanceConstraints.delta(pd, i, d1, d2))
+            {
+                m_jacobiSolver.addDelta(tid, m_DistanceConstraints.p1[i], d1);
+                m_jacobiSolver.addDelta(tid, m_DistanceConstraints.p2[i], d2);
+            }
+        }
 
-            m_Particles.push_back(nParticle);
-            nRB->addParticle(point, nParticle);
+        #pragma omp for
+        for(int i=0; i < numShapeMatching; i++)
+        {
+            auto &c = m_ShapeMatchingConstraints[i];
+            if(c->indices().empty() || m_islands.asleep(c->indices()[0]))
+                continue;
 
-            std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(nParticle);
-            auto sO = m_scene->addSceneObjectFromParticle(pDynamicObject, nParticle, color);
-            sO->isHidden(true);
+            c->matchShape();
+            const std::vector<ParticlePtr> &particles = c->particles();
+            float f = c->compliant() ? c->complianceFactor() : 1.0f;
+            for(int j=0; j < int(particles.size()); j++)
+            {
+                QVector3D d = c->goalPosition(j) - particles[j]->p();
+                if(c->compliant())
+                    d *= particles[j]->w() * particles[j]->mass() * f;
+                m_jacobiSolver.addDelta(tid, particles[j]->index(), d);
+            }
         }
     }
-    auto smCstr = nRB->createConstraint();
-    m_Constraints.push_back(smCstr);
-
-    m_DynamicObjects.push_back(nRB);
 
-    nRB->updateModelBuffers();
-    _sceneObject->makeDynamic(nRB);
+    m_jacobiSolver.apply(pd, m_overRelaxation);
+}
 
-    return nRB;
+void DynamicsWorld::projectCollisionConstraints()
+{
+    ParticleData &pd = m_particleData;
+    ContactArena &contacts = m_contactArena;
+    m_CollisionColoring.project([&](int i){ contacts.project(pd, i); });
 }
 
-void DynamicsWorld::addDynamicObjectAsRigidBodyGrid(pSceneOb _sceneObject, std::string _path, int _color)
+// constraints of sleeping islands are left out, an island sleeps or wakes
+// as a whole so the first particle tells for all of them
+void DynamicsWorld::colorConstraints()
 {
-    FILE * file = std::fopen(_path.c_str(), "r");
-    if( file == nullptr ){
-        mlog<<"Impossible to open the file !\n";
+    if(!m_coloringDirty)
         return;
+
+    int numNodes = int(m_particleData.size());
+    m_DistanceColoring.reset(numNodes);
+    for(int i=0; i < int(m_DistanceConstraints.size()); i++)
+    {
+        if(m_islands.asleep(m_DistanceConstraints.p1[i]))
+            continue;
+        m_DistanceColoring.add(i, m_DistanceConstraints.p1[i], m_DistanceConstraints.p2[i]);
     }
 
-    std::vector<QVector3D> verts;
-    std::vector<QVector3D> normals;
+    std::vector<int> nodes;
+    std::vector<int> cost;
+    m_ShapeMatchingColoring.reset(numNodes);
+    for(int i=0; i < int(m_ShapeMatchingConstraints.size()); i++)
+    {
+        const AlignedVector<int> &indices = m_ShapeMatchingConstraints[i]->indices();
+        if(indices.empty() || m_islands.asleep(indices[0]))
+            continue;
 
-    while( 1 ){
+        nodes.clear();
+        for(const ParticlePtr &p : m_ShapeMatchingConstraints[i]->particles())
+            nodes.push_back(p->index());
+        m_ShapeMatchingColoring.add(i, nodes.data(), int(nodes.size()));
+        cost.push_back(int(nodes.size()));
+    }
+    m_ShapeMatchingScheduler.build(m_ShapeMatchingColoring, cost);
 
-        char lineHeader[128];
-        // read the first word of the line
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
-            break; // EOF = End Of File. Quit the loop.
+    m_coloringDirty = false;
+}
 
+// contacts found by the awake particles wake the sleeping islands they
+// touch, a new pin wakes the island of its particle
+void DynamicsWorld::wakeTouchedIslands()
+{
+    for(const ParticleContact &c : m_contacts)
+    {
+        if(c.type == ParticleContact::PLANE || c.type == ParticleContact::TRIANGLE || c.type == ParticleContact::SDF)
+            continue;
 
-        if ( std::strcmp( lineHeader, "v" ) == 0 ){
-            float x,y,z;
-            fscanf(file, "%f %f %f\n", &x, &y, &z );
-            verts.push_back(QVector3D(x,y,z));
-        // else : parse lineHeader
-        }
+        m_islands.wake(c.a);
+        if(c.type == ParticleContact::PARTICLE)
+            m_islands.wake(c.b);
+    }
 
-        if ( std::strcmp( lineHeader, "vn" ) == 0 ){
-            float x,y,z;
-            fscanf(file, "%f %f %f\n", &x, &y, &z );
-            normals.push_back(QVector3D(x,y,z));
-        // else : parse lineHeader
-        }
+    for(auto &c : m_PinConstraints)
+    {
+        if(ParticlePtr p = c->m_Particles[0].lock())
+            m_islands.wake(p->index());
     }
 
-    if(normals.size() != verts.size())
-        mlog<<"warning -------verts are not normals";
+    if(m_islands.wakeQueued(m_particleData))
+        m_coloringDirty = true;
+}
 
-    // make rigid body instance
-    auto nRBG = std::make_shared<RigidBodyGrid>();
-    objectCount++;
+// the islands of the awake particles, joined by their constraints and this
+// frames contacts. Pins and colliders are moved by the user, they keep
+// their islands awake.
+void DynamicsWorld::updateIslands()
+{
+    if(!m_sleeping)
+        return;
+
+    m_islands.beginFrame();
 
-    int i = 0;
-    for(auto v : verts)
+    for(int i=0; i < int(m_DistanceConstraints.size()); i++)
     {
-         pCount++;
-         auto nParticle = std::make_shared<Particle>(v.x(), v.y(), v.z(), 33);
-         nParticle->ID = pCount;
-         nParticle->bodyID = objectCount;
+        m_islands.connect(m_DistanceConstraints.p1[i], m_DistanceConstraints.p2[i]);
+    }
 
-         nParticle->collisionGradLen = normals[i].length();
+    for(auto &c : m_ShapeMatchingConstraints)
+    {
+        const AlignedVector<int> &indices = c->indices();
+        if(!indices.empty() && !m_islands.asleep(indices[0]))
+            m_islands.connect(indices.data(), int(indices.size()));
+    }
 
-//         if(nParticle->collisionGradLen <= 0.01)
-//             nParticle->collisionGradLen += 0.01;
-//         nParticle->collisionGradLen *= 1.5;
+    std::vector<int> indices;
+    for(auto &c : m_PinTogetherConstraints)
+    {
+        indices.clear();
+        for(const ParticlePtr &p : c->particles())
+            indices.push_back(p->index());
+        m_islands.connect(indices.data(), int(indices.size()));
+    }
 
-//         mlog<<"p "<<i<<nParticle->collisionGradLen;
+    for(const ParticleContact &c : m_contacts)
+    {
+        if(c.type == ParticleContact::PARTICLE)
+            m_islands.connect(c.a, c.b);
+        else if(c.type == ParticleContact::COLLIDER)
+            m_islands.keepAwake(c.a);
+    }
 
-         nParticle->collisionVector = (normals[i]).normalized();
-         nParticle->collisionVector = (normals[i] * 1000000).normalized();
+    for(auto &c : m_PinConstraints)
+    {
+        if(ParticlePtr p = c->m_Particles[0].lock())
+            m_islands.keepAwake(p->index());
+    }
 
-//         nParticle->collisionVector = QVector3D(0,1,0);
+    if(m_islands.sleep(m_particleData, m_sleepVelocity, m_sleepFrames))
+        m_coloringDirty = true;
+}
 
-//         qDebug()<<"collision normal : "<<pCount<< " = "<< nParticle->collisionVector <<nParticle->collisionGradLen;
-//         nParticle->setMass(0.1);
+void DynamicsWorld::info()
+{
+    qDebug()<<"p1: "<<m_Particles[0]->x()<<m_Particles[0]->ID()<<m_Particles[0]->radius();
+}
 
-         m_Particles.push_back(nParticle);
-         nRBG->addParticle(v, nParticle);
+DynamicsWorldController* DynamicsWorld::controller()
+{
+    if(m_DynamicsWorldController)
+        return m_DynamicsWorldController;
+    return nullptr;
+}
 
-         std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(nParticle);
-         auto sO = m_scene->addSceneObjectFromParticle(pDynamicObject, nParticle, _color);
-         sO->isHidden(true);
-         i++;
+void DynamicsWorld::setSleeping(bool _sleeping)
+{
+    m_sleeping = _sleeping;
+    if(!_sleeping)
+    {
+        m_islands.wakeAll();
+        m_coloringDirty = true;
     }
+}
 
-    auto smCstr = nRBG->createConstraint();
-    for(auto pt : nRBG->getParticles())
+void DynamicsWorld::setSimulate(bool _isSimulating)
+{
+    m_simulate = _isSimulating;
+}
+
+void DynamicsWorld::setAllParticlesMass(float _m)
+{
+    for(auto p : m_Particles)
     {
-        if(ParticlePtr p = pt.lock())
-        {
-            QVector3D tmp = p->x;
-            QVector4D pos = QVector4D(p->x.x(), p->x.y(), p->x.z(), 1);
-            pos = _sceneObject->getMatrix() * pos;
-            p->x = QVector3D(pos.x(), pos.y(), pos.z());
-            p->p = QVector3D(pos.x(), pos.y(), pos.z());
-        }
+        if(p->mass() <= 0.001)
+            continue;
+        p->setMass(_m);
     }
-    m_Constraints.push_back(smCstr);
-    m_DynamicObjects.push_back(nRBG);
+}
 
-    _sceneObject->makeDynamic(nRBG);
-//    _sceneObject->isHidden(true);
-    smCstr->project();
-    objectCount++;
+void DynamicsWorld::setAllDistanceConstraintStretch(float _globalStretch)
+{
+    m_DistanceConstraintStretch = _globalStretch;
+    m_DistanceConstraints.setStretch(_globalStretch);
 }
 
-DynamicObjectPtr DynamicsWorld::addDynamicObjectAsNonUniformParticle(pSceneOb _sceneObject, float radius)
+void DynamicsWorld::setAllDistanceConstraintCompress(float _globalCompress)
 {
-    pCount++;
-    auto nParticle = std::make_shared<Particle>(_sceneObject->getPos().x(), _sceneObject->getPos().y(), _sceneObject->getPos().z(), 33);
-    nParticle->setRadius(radius);
-    nParticle->setMass(0);
-    nParticle->p = _sceneObject->getPos();
-    nParticle->x = _sceneObject->getPos();
-    m_NonUniformParticles.push_back(nParticle);
-    std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(nParticle);
-    _sceneObject->makeDynamic(pDynamicObject);
+    m_distanceConstraintCompress = _globalCompress;
+    m_DistanceConstraints.setCompress(_globalCompress);
+}
 
-    nParticle->ID =  991;
+void DynamicsWorld::setAllDistanceConstraintCompliance(float _compliance)
+{
+    m_distanceConstraintCompliance = _compliance;
+    m_DistanceConstraints.setCompliance(_compliance);
+}
 
-    return pDynamicObject;
+void DynamicsWorld::setAllBendingCompliance(float _compliance)
+{
+    m_bendingCompliance = _compliance;
+    m_DistanceConstraints.setBendingCompliance(_compliance);
 }
 
+void DynamicsWorld::setAllShapeMatchingCompliance(float _compliance)
+{
+    m_shapeMatchingCompliance = _compliance;
+    for(auto &c : m_ShapeMatchingConstraints)
+        c->setCompliance(_compliance);
+}
 
-DynamicObjectPtr DynamicsWorld::addDynamicObjectAsSoftBody(pSceneOb _sceneObject, float _mass)
+void DynamicsWorld::setShapeMatchingRotationMethod(ShapeMatchingConstraint::RotationMethod _method)
 {
-    if(!_sceneObject->model())
-        return nullptr;
+    m_shapeMatchingRotation = _method;
+    for(auto &c : m_ShapeMatchingConstraints)
+        c->setRotationMethod(_method);
+}
 
-     auto nSB = std::make_shared<SoftBody>(_sceneObject->model());
-     objectCount++;
-     ModelPtr model = nSB->getModel();
-      _sceneObject->setModel(nSB->getModel());
+// XPBD multipliers start from zero every time step
+void DynamicsWorld::resetMultipliers(float _dt)
+{
+    m_DistanceConstraints.resetLambda(_dt);
+    for(auto &c : m_ShapeMatchingConstraints)
+        c->resetLambda(_dt);
+}
 
-     for(unsigned int i = 0; i < model->getNumShapes(); i++)
-     {
-         ShapePtr shape = model->getShape(i);
-         for(auto point : shape->getPoints())
-         {
-             QVector3D pos = _sceneObject->getMatrix() * point;
-             pCount++;
-             auto nParticle = std::make_shared<Particle>(pos.x(), pos.y(), pos.z(), 33);
-             nParticle->ID = pCount;
-             nParticle->bodyID = objectCount;
-
-             m_Particles.push_back(nParticle);
-             nSB->addParticle(point, nParticle);
-
-             std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(nParticle);
-             auto sO = m_scene->addSceneObjectFromParticle(pDynamicObject, nParticle);
-             sO->isHidden(true);
-         }
-     }
-     std::vector< std::set<int> > constraintIdxs  = nSB->createConstraintNetwork();
+void DynamicsWorld::step()
+{
+    m_simulate = true;
+    update();
+    m_simulate = false;
+    publish(1);
+}
 
-     for(auto set : constraintIdxs)
-     {
-         if(set.size() < 2)
-             continue;
+int DynamicsWorld::getTimeStepSizeMS()
+{
+    return m_dt * 1000;
+}
 
-         std::set<int>::iterator itA, itB;
-         itA = set.begin();
-         itB = set.begin();
-         std::advance(itB, 1);
+void DynamicsWorld::pbdDamping()
+{
+    // bodies are only ever appended, their particle ranges are rebuilt then
+    if(m_dampingObjects != m_DynamicObjects.size())
+    {
+        m_damping.clear();
+        std::vector<int> indices;
+        for(auto dObject : m_DynamicObjects)
+        {
+            indices.clear();
+            for(auto p : dObject->getParticles())
+            {
+                if(auto particle = p.lock())
+                    indices.push_back(particle->index());
+            }
+            m_damping.addBody(indices.data(), int(indices.size()));
+        }
+        m_dampingObjects = m_DynamicObjects.size();
+    }
 
-         int A = *itA;
-         int B = *itB;
+    m_damping.damp(m_particleData, m_pbdDamping);
+}
 
-         ParticlePtr p1 = nSB->getParticles()[A].lock();
-         ParticlePtr p2 = nSB->getParticles()[B].lock();
+void DynamicsWorld::compare(ParticlePtr _a)
+{
+    mlog<<"compare";
+}
 
-         std::shared_ptr<DistanceEqualityConstraint> nCstrPtr = addDistanceEqualityConstraint(p1, p2);
-     };
+/*
+ *
+ * from https://stackoverflow.com/questions/2047414/advantages-of-stdfor-each-over-for-loop
+ *
+ * for_each(a.begin(), a.end(), a_item_handler);
+is better than
 
-     m_DynamicObjects.push_back(nSB);
-     nSB->turnOffSelfCollision();
-     nSB->updateModelBuffers();
-     _sceneObject->makeDynamic(nSB);
-     return nSB;
+for(auto& item: a) {
+    a_item_handler(a);
 }
+*/
 
 void DynamicsWorld::addRope(const QVector3D &_start, const QVector3D &_end, int _numParticles)
 {
@@ -602,15 +937,8 @@ void DynamicsWorld::addRope(const QVector3D &_start, const QVector3D &_end, int
         for(int i=0; i <= _numParticles; i++)
         {
             QVector3D pos = _start + (i * step * n);
-            pCount++;
-            auto nParticle = std::make_shared<Particle>(pos.x(), pos.y(), pos.z(), 33);
-            nParticle->ID = pCount;
-            nParticle->bodyID = objectCount;
-            m_Particles.push_back(nParticle);
-
-            std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(nParticle);
-            auto sO = m_scene->addSceneObjectFromParticle(pDynamicObject, nParticle);
-            sO->isHidden(true);
+            auto nParticle = addParticle(pos, objectCount);
+            notifyParticleAdded(nParticle);
 
             if(!prevP)
             {
@@ -623,10 +951,81 @@ void DynamicsWorld::addRope(const QVector3D &_start, const QVector3D &_end, int
 }
 
 
-ParticlePtr DynamicsWorld::addParticle(float _x, float _y, float _z)
+std::shared_ptr<RigidBodyGrid> DynamicsWorld::addRigidBodyGrid(const std::vector<QVector3D> &_verts,
+                                                              const std::vector<QVector3D> &_normals,
+                                                              const QMatrix4x4 &_transform, int _color)
+{
+    auto nRBG = std::make_shared<RigidBodyGrid>();
+    objectCount++;
+
+    for(unsigned int i = 0; i < _verts.size(); i++)
+    {
+         auto nParticle = addParticle(_verts[i], objectCount);
+
+         if(i < _normals.size())
+         {
+             nParticle->setCollisionGradient(_normals[i].length(), (_normals[i] * 1000000).normalized());
+             m_sdfParticles = true;
+         }
+
+         nRBG->addParticle(_verts[i], nParticle);
+         notifyParticleAdded(nParticle, _color);
+    }
+
+    // rest shape is the untransformed grid, the particles start at the transform
+    auto smCstr = nRBG->createConstraint();
+    for(auto pt : nRBG->getParticles())
+    {
+        if(ParticlePtr p = pt.lock())
+        {
+            QVector4D pos = QVector4D(p->x().x(), p->x().y(), p->x().z(), 1);
+            pos = _transform * pos;
+            p->x() = QVector3D(pos.x(), pos.y(), pos.z());
+            p->p() = QVector3D(pos.x(), pos.y(), pos.z());
+        }
+    }
+    smCstr->setCompliance(m_shapeMatchingCompliance);
+    smCstr->setRotationMethod(m_shapeMatchingRotation);
+    smCstr->m_handle = m_ShapeMatchingConstraints.insert(smCstr);
+    m_coloringDirty = true;
+    m_DynamicObjects.push_back(nRBG);
+
+    smCstr->project();
+    objectCount++;
+    return nRBG;
+}
+
+std::shared_ptr<RigidBodyGrid> DynamicsWorld::addRigidBodyGrid(const SignedDistanceField &_field, float _spacing,
+                                                              const QMatrix4x4 &_transform, int _color)
+{
+    std::vector<QVector3D> verts, gradients;
+    _field.sampleInterior(_spacing, verts, gradients);
+    if(verts.empty())
+        return nullptr;
+    return addRigidBodyGrid(verts, gradients, _transform, _color);
+}
+
+void DynamicsWorld::notifyParticleAdded(ParticlePtr _particle, int _color)
+{
+    if(!m_listener)
+        return;
+
+    // the radius is read here, the render thread only sees presented ones
+    std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(_particle);
+    DynamicsWorldListener *listener = m_listener;
+    float radius = _particle->radius();
+    postToRenderer([listener, pDynamicObject, _particle, radius, _color](){
+        listener->particleAdded(pDynamicObject, _particle, radius, _color);
+    });
+}
+
+ParticlePtr DynamicsWorld::addParticle(const QVector3D &_pos, int _bodyID)
 {
     pCount++;
-    auto pParticle  = std::make_shared<Particle>(_x, _y, _z, pCount);
+    int idx = m_particleData.add(_pos, particleMass);
+    auto pParticle  = std::make_shared<Particle>(&m_particleData, idx);
+    pParticle->setID(pCount);
+    pParticle->setBodyID(_bodyID);
     m_Particles.push_back(pParticle);
     return pParticle;
 }
@@ -636,26 +1035,100 @@ void DynamicsWorld::addPlane(const Plane &_plane)
     m_Planes.push_back(_plane);
 }
 
+void DynamicsWorld::addTriangleMesh(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                                    uint32_t _layer, uint32_t _layerMask)
+{
+    m_triangleMeshes.add(_vertices, _indices, _layer, _layerMask);
+}
+
+void DynamicsWorld::addSdfCollider(std::shared_ptr<SignedDistanceField> _field, const QMatrix4x4 &_transform,
+                                   uint32_t _layer, uint32_t _layerMask)
+{
+    if(!_field || _field->empty())
+        return;
+
+    SdfCollider collider;
+    collider.field = _field;
+    collider.transform = _transform;
+    collider.inverse = _transform.inverted();
+    collider.scale = _transform.mapVector(QVector3D(1,0,0)).length();
+    collider.layer = _layer;
+    collider.layerMask = _layerMask;
+    m_sdfColliders.push_back(collider);
+}
+
 void DynamicsWorld::collisionCheckAll()
 {
-    m_hashGrid.clear();
+    findContacts();
+    emitContacts();
+}
+
+void DynamicsWorld::findContacts()
+{
+    m_hashGrid.build(m_particleData);
+    m_triangleMeshes.build();
+
+    int numParticles = int(m_particleData.size());
+    m_threadContacts.resize(omp_get_max_threads());
+    for(auto &contacts : m_threadContacts)
+        contacts.clear();
+
+    // find contacts against the frozen grid, static scheduling hands every
+    // thread one contiguous range of particles
+    #pragma omp parallel
+    {
+        std::vector<ParticleContact> &contacts = m_threadContacts[omp_get_thread_num()];
+        #pragma omp for schedule(static)
+        for(int i=0; i < numParticles; i++)
+        {
+            collisionCheck(i, contacts);
+        }
+    }
+
+    // merged in thread order, the same list a single thread would find
+    m_contacts.clear();
+    for(auto &contacts : m_threadContacts)
+        m_contacts.insert(m_contacts.end(), contacts.begin(), contacts.end());
+}
 
-    for( ParticlePtr p : m_Particles)
+void DynamicsWorld::emitContacts()
+{
+    m_CollisionColoring.reset(int(m_particleData.size() + m_nonUniformParticleData.size()));
+    if(m_sdfParticles)
+        updateCollisionNormals();
+    for(const ParticleContact &c : m_contacts)
     {
-        collisionCheck( p);
+        emitContact(c);
     }
 }
 
-void DynamicsWorld::collisionCheck(ParticlePtr p)
+void DynamicsWorld::collisionCheck(int _idx, std::vector<ParticleContact> &_contacts)
 {
-        int3 pCell = m_hashGrid.pointToCell(
-                    p->position().x(),
-                    p->position().y(),
-                    p->position().z() );
+        const ParticleData &pd = m_particleData;
+        const ParticleData &colliders = m_nonUniformParticleData;
+
+        // out of every layer, nothing to find
+        if(!pd.layerMask[_idx])
+            return;
+
+        // a sleeping particle is found by its awake neighbours, only the
+        // colliders are checked to wake it
+        if(m_islands.asleep(_idx))
+        {
+            for(int i=0; i < int(colliders.size()); i++)
+            {
+                if(pd.collides(_idx, colliders, i))
+                    checkSphereSphere(_idx, colliders, i, ParticleContact::COLLIDER, _contacts);
+            }
+            return;
+        }
+
+        const QVector3D &pos = pd.x[_idx];
+        int3 pCell = m_hashGrid.pointToCell(pos.x(), pos.y(), pos.z());
 
-        size_t pHash = m_hashGrid.hashFunction(pCell);
-           p->setHash(pHash);
-        m_hashGrid.insert(pHash, p);
+        // neighbouring cells can share a bucket, visit each bucket once
+        size_t buckets[27];
+        int numBuckets = 0;
 
         int level = 1;
         for(int y = -1 ; y <= level ; y++)
@@ -669,41 +1142,68 @@ void DynamicsWorld::collisionCheck(ParticlePtr p)
                     nCell.j = pCell.j + y;
                     nCell.k = pCell.k + z;
                     size_t hash = m_hashGrid.hashFunction(nCell);
-                    if(m_hashGrid.cellExists(hash))
-                    {
-                        std::unordered_map< size_t , std::list< ParticlePtr >>::iterator test = m_hashGrid.m_buckets.find(hash);
-                        for(auto np : test->second)
-                        {
-                            if(p->bodyID != np->bodyID)
-                                checkSphereSphere(p,np);
-                        }
-                    }
+                    if(std::find(buckets, buckets + numBuckets, hash) == buckets + numBuckets)
+                        buckets[numBuckets++] = hash;
                 }
             }
         }
-        for(auto plane : m_Planes)
+
+        for(int b=0; b < numBuckets; b++)
+        {
+            int end = m_hashGrid.cellEnd(buckets[b]);
+            for(int s = m_hashGrid.cellStart(buckets[b]); s < end; s++)
+            {
+                // every pair is checked once, by its higher index or by
+                // its awake particle
+                int j = m_hashGrid.sortedParticle(s);
+                if(j == _idx || (j > _idx && !m_islands.asleep(j)))
+                    continue;
+
+                if(pd.collides(_idx, j))
+                    checkSphereSphere(_idx, pd, j, ParticleContact::PARTICLE, _contacts);
+            }
+        }
+
+        for(int i=0; i < int(m_Planes.size()); i++)
+        {
+            const Plane &plane = m_Planes[i];
+            if(collisionLayersMatch(pd.layer[_idx], pd.layerMask[_idx], plane.Layer, plane.LayerMask))
+                checkSpherePlane(_idx, i, _contacts);
+        }
+
+        const TriangleMeshCollider &meshes = m_triangleMeshes;
+        meshes.overlap(pd.p[_idx], pd.r[_idx] + m_contactMargin, [&](int i){
+            const TriangleMeshCollider::Triangle &t = meshes.triangle(i);
+            if(collisionLayersMatch(pd.layer[_idx], pd.layerMask[_idx], t.layer, t.layerMask))
+                checkSphereTriangle(_idx, i, _contacts);
+        });
+
+        for(int i=0; i < int(m_sdfColliders.size()); i++)
         {
-            checkSpherePlane(p, plane);
+            const SdfCollider &sdf = m_sdfColliders[i];
+            if(collisionLayersMatch(pd.layer[_idx], pd.layerMask[_idx], sdf.layer, sdf.layerMask))
+                checkSphereSdf(_idx, i, _contacts);
         }
 
-        for(auto nonUParticle  : m_NonUniformParticles)
+        for(int i=0; i < int(colliders.size()); i++)
         {
-            checkSphereSphere(p, nonUParticle);
+            if(pd.collides(_idx, colliders, i))
+                checkSphereSphere(_idx, colliders, i, ParticleContact::COLLIDER, _contacts);
         }
 }
 
-void DynamicsWorld::checkSphereSphere(const ParticlePtr p1, const ParticlePtr p2)
+void DynamicsWorld::checkSphereSphere(int _idx, const ParticleData &_other, int _otherIdx,
+                                      ParticleContact::Type _type, std::vector<ParticleContact> &_contacts)
 {
+    const ParticleData &pd = m_particleData;
     float d;
-    if(m_CollisionDetect.checkSphereSphere(p1->p, p2->p, d, p1->radius(), p2->radius())){
-        addParticleParticleConstraint(p1, p2);
-        addFrictionConstraint(p1, p2);
-    }
 
-    float d2;
-    if(m_CollisionDetect.checkSphereSphere(p1->x, p2->x, d2,p1->radius(), p2->radius())){
-        addParticleParticlePreConditionConstraint(p1, p2);
-    }
+    ParticleContact contact;
+    contact.type = _type;
+    contact.a = _idx;
+    contact.b = _otherIdx;
+    if(m_CollisionDetect.checkSphereSphere(pd.p[_idx], _other.p[_otherIdx], d, pd.r[_idx] + m_contactMargin, _other.r[_otherIdx]))
+        _contacts.push_back(contact);
 }
 
 void DynamicsWorld::generateData()
@@ -721,38 +1221,221 @@ QVector3D* DynamicsWorld::debugDrawLineData()
     return nullptr;
 }
 
-void DynamicsWorld::checkSpherePlane(const ParticlePtr p1, const Plane &_plane)
+void DynamicsWorld::checkSpherePlane(int _idx, int _plane, std::vector<ParticleContact> &_contacts)
 {
-    float dist = m_CollisionDetect.distanceFromPointToPlane(p1->p, _plane.Normal, (_plane.Offset + (p1->r *_plane.Normal)));
-    if(dist > 0)
+    const ParticleData &pd = m_particleData;
+    const Plane &plane = m_Planes[_plane];
+    const QVector3D &x = pd.x[_idx];
+    const QVector3D &p = pd.p[_idx];
+    float r = pd.r[_idx];
+
+    float dist = m_CollisionDetect.distanceFromPointToPlane(p, plane.Normal, (plane.Offset + (r * plane.Normal)));
+    if(dist > m_contactMargin)
+        return;
+
+    ParticleContact contact;
+    contact.type = ParticleContact::PLANE;
+    contact.a = _idx;
+    contact.b = _plane;
+
+    // a candidate for the substeps, they find the entry point themselves
+    if(m_contactMargin > 0)
+    {
+        _contacts.push_back(contact);
         return;
+    }
 
-    QVector3D qc = m_CollisionDetect.intersectRayPlane(p1->x, p1->p, _plane.Normal, (_plane.Offset + (p1->r *_plane.Normal)));
+    QVector3D qc = m_CollisionDetect.intersectRayPlane(x, p, plane.Normal, (plane.Offset + (r * plane.Normal)));
 
-    if((p1->x - p1->p).length() < 0.0001)
+    if((x - p).length() < 0.0001)
         return;
 
     if(isnan(qc.x()))
         return;
 
-    auto hsCstr = std::make_shared<HalfSpaceConstraint>(p1, qc, _plane.Normal);
-    p1->m_CollisionConstraints.push_back(hsCstr);
-    addHalfSpaceFrictionConstraint(p1, _plane.Offset, _plane.Normal);
-    addHalfSpacePreConditionConstraint(p1, qc, _plane.Normal);
+    contact.qc = qc;
+    _contacts.push_back(contact);
+}
+
+// The particle is pushed out to the side it came from. Inside the face
+// that is along the normal, over an edge or corner straight away from it.
+void DynamicsWorld::checkSphereTriangle(int _idx, int _triangle, std::vector<ParticleContact> &_contacts)
+{
+    const ParticleData &pd = m_particleData;
+    const TriangleMeshCollider::Triangle &t = m_triangleMeshes.triangle(_triangle);
+    const QVector3D &p = pd.p[_idx];
+    float r = pd.r[_idx];
+
+    bool face;
+    QVector3D q = TriangleMeshCollider::closestPoint(p, t, face);
+    QVector3D d = p - q;
+    float dist = d.length();
+    if(dist > r + m_contactMargin)
+        return;
+
+    ParticleContact contact;
+    contact.type = ParticleContact::TRIANGLE;
+    contact.a = _idx;
+    contact.b = _triangle;
 
+    if(m_contactMargin > 0)
+    {
+        _contacts.push_back(contact);
+        return;
+    }
+
+    float side = QVector3D::dotProduct(pd.x[_idx] - t.a, t.n) >= 0 ? 1.0f : -1.0f;
+    if(face || dist < 1e-6f)
+        contact.n = side * t.n;
+    else
+        contact.n = d / dist;
+    contact.qc = q + r * contact.n;
+    _contacts.push_back(contact);
+}
+
+// Pushed out along the gradient to the surface. Deeper than the band the
+// gradient vanishes, particles that far in are lost.
+void DynamicsWorld::checkSphereSdf(int _idx, int _sdf, std::vector<ParticleContact> &_contacts)
+{
+    const ParticleData &pd = m_particleData;
+    const SdfCollider &sdf = m_sdfColliders[_sdf];
+    const QVector3D &p = pd.p[_idx];
+    float r = pd.r[_idx];
+
+    // past the band every particle looks the same distance away
+    QVector3D local = sdf.inverse.map(p);
+    float fieldDist = sdf.field->distance(local);
+    float dist = fieldDist * sdf.scale;
+    if(fieldDist >= sdf.field->band() || dist > r + m_contactMargin)
+        return;
+
+    ParticleContact contact;
+    contact.type = ParticleContact::SDF;
+    contact.a = _idx;
+    contact.b = _sdf;
+
+    if(m_contactMargin > 0)
+    {
+        _contacts.push_back(contact);
+        return;
+    }
+
+    QVector3D n = sdf.transform.mapVector(sdf.field->gradient(local)).normalized();
+    if(n.isNull())
+        return;
+
+    contact.n = n;
+    contact.qc = p - (dist - r) * n;
+    _contacts.push_back(contact);
 }
 
-std::shared_ptr<DistanceEqualityConstraint> DynamicsWorld::addDistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2)
+// the outward directions of the rigid samples follow their bodies
+void DynamicsWorld::updateCollisionNormals()
 {
-    auto nSpring = std::make_shared<DistanceEqualityConstraint>(_p1, _p2);
-    float d = (_p1->x - _p2->x).length();
-    nSpring->setRestLength(d);
-    m_Constraints.push_back(nSpring);
-    _p1->m_Constraints.push_back(nSpring);
-    _p2->m_Constraints.push_back(nSpring);
+    ParticleData &pd = m_particleData;
+    for(auto &c : m_ShapeMatchingConstraints)
+    {
+        const Eigen::Matrix3f &R = c->rotation();
+        for(int i : c->indices())
+        {
+            const QVector3D &v = pd.collisionVector[i];
+            Eigen::Vector3f n = R * Eigen::Vector3f(v.x(), v.y(), v.z());
+            pd.collisionNormal[i] = QVector3D(n.x(), n.y(), n.z());
+        }
+    }
+}
+
+// Contact normal of two particles from the gradients of their bodies, zero
+// to separate them along their centers. The sample closer to its surface
+// decides (Macklin et al. 2014, unified particle physics). Deep inside it
+// knows the way out better than the centers, at the surface the centers
+// are used unless they point into its body.
+QVector3D DynamicsWorld::sdfContactNormal(int _a, int _b) const
+{
+    const ParticleData &pd = m_particleData;
+    float depthA = pd.collisionGradLen[_a];
+    float depthB = pd.collisionGradLen[_b];
+    if(depthA <= 0 && depthB <= 0)
+        return QVector3D(0,0,0);
+
+    // pointing from a to b
+    bool useA = depthA > 0 && (depthB <= 0 || depthA <= depthB);
+    int i = useA ? _a : _b;
+    QVector3D n = useA ? pd.collisionNormal[_a] : -pd.collisionNormal[_b];
+    if(n.isNull())
+        return QVector3D(0,0,0);
+
+    if(pd.collisionGradLen[i] >= pd.r[i])
+        return n;
+
+    QVector3D centers = (pd.x[_b] - pd.x[_a]).normalized();
+    float d = QVector3D::dotProduct(centers, n);
+    if(d >= 0)
+        return QVector3D(0,0,0);
+    return (centers - 2 * d * n).normalized();
+}
+
+// colliders are numbered after the world particles in the coloring graph
+void DynamicsWorld::emitContact(const ParticleContact &_contact)
+{
+    ParticleData &pd = m_particleData;
+    int a = _contact.a;
+
+    if(_contact.type == ParticleContact::TRIANGLE || _contact.type == ParticleContact::SDF)
+    {
+        ContactConstraint::Target target = _contact.type == ParticleContact::TRIANGLE ? ContactConstraint::TRIANGLE
+                                                                                      : ContactConstraint::SDF;
+        int hs = m_contactArena.addHalfSpace(a, _contact.qc, _contact.n, target, _contact.b);
+        m_CollisionColoring.add(hs, a);
+        int hsFriction = m_contactArena.addHalfSpaceFriction(a, _contact.n, target, _contact.b);
+        m_CollisionColoring.add(hsFriction, a);
+        m_contactArena.addHalfSpacePreCondition(a, _contact.qc, _contact.n);
+        return;
+    }
+
+    if(_contact.type == ParticleContact::PLANE)
+    {
+        const Plane &plane = m_Planes[_contact.b];
+        int hs = m_contactArena.addHalfSpace(a, _contact.qc, plane.Normal, ContactConstraint::PLANE, _contact.b);
+        m_CollisionColoring.add(hs, a);
+        int hsFriction = m_contactArena.addHalfSpaceFriction(a, plane.Normal, ContactConstraint::PLANE, _contact.b);
+        m_CollisionColoring.add(hsFriction, a);
+        m_contactArena.addHalfSpacePreCondition(a, _contact.qc, plane.Normal);
+        return;
+    }
+
+    ParticleData *other = &pd;
+    int nodeB = _contact.b;
+    ContactConstraint::Target target = ContactConstraint::PARTICLE;
+    if(_contact.type == ParticleContact::COLLIDER)
+    {
+        other = &m_nonUniformParticleData;
+        nodeB += int(pd.size());
+        target = ContactConstraint::COLLIDER;
+    }
+
+    QVector3D n(0,0,0);
+    if(_contact.type == ParticleContact::PARTICLE && m_sdfParticles)
+        n = sdfContactNormal(a, _contact.b);
+
+    int pp = m_contactArena.addParticleParticle(a, other, _contact.b, target, n);
+    m_CollisionColoring.add(pp, a, nodeB);
+    int friction = m_contactArena.addFriction(pd, a, other, _contact.b, target);
+    m_CollisionColoring.add(friction, a, nodeB);
+}
 
-    m_debugLines.push_back(&_p1->x);
-    m_debugLines.push_back(&_p2->x);
+std::shared_ptr<DistanceEqualityConstraint> DynamicsWorld::addDistanceEqualityConstraint(const ParticlePtr _p1, const ParticlePtr _p2,
+                                                                                        bool _bending)
+{
+    float d = (_p1->x() - _p2->x()).length();
+    SlotHandle handle = m_DistanceConstraints.add(_p1->index(), _p2->index(), d,
+                                                  m_DistanceConstraintStretch,
+                                                  m_distanceConstraintCompress,
+                                                  _bending ? m_bendingCompliance : m_distanceConstraintCompliance,
+                                                  _bending);
+    auto nSpring = std::make_shared<DistanceEqualityConstraint>(_p1, _p2, &m_DistanceConstraints, handle);
+    m_coloringDirty = true;
+    m_distanceVersion++;
 
     return nSpring;
 }
@@ -764,98 +1447,152 @@ std::shared_ptr<PinTogetherConstraint> DynamicsWorld::addPinTogetherConstraint(s
     {
         p->m_Constraints.push_back(ptCstr);
     }
-    m_Constraints.push_back(ptCstr);
+    ptCstr->m_handle = m_PinTogetherConstraints.insert(ptCstr);
     return  ptCstr;
 }
 
-void DynamicsWorld::addParticleParticleConstraint(const ParticlePtr _p1, const ParticlePtr _p2)
+std::shared_ptr<PinConstraint> DynamicsWorld::addPinConstraint(const ParticlePtr _p, const QVector3D &_pos)
 {
-    auto ppCstr = std::make_shared<ParticleParticleConstraint>(_p1, _p2);
-    _p1->m_CollisionConstraints.push_back(ppCstr);
-    _p2->m_CollisionConstraints.push_back(ppCstr);
+    auto pinCstr = std::make_shared<PinConstraint>(_p, _pos);
+    _p->m_Constraints.push_back(pinCstr);
+    pinCstr->m_handle = m_PinConstraints.insert(pinCstr);
+    return pinCstr;
 }
 
-void DynamicsWorld::addParticleParticlePreConditionConstraint(const ParticlePtr _p1, const ParticlePtr _p2)
+int DynamicsWorld::particleKey(const ParticlePtr &_p) const
 {
-    auto ppCstr = std::make_shared<ParticleParticlePreConditionConstraint>(_p1, _p2);
-    _p1->m_PreConditionConstraints.push_back(ppCstr);
-    _p2->m_PreConditionConstraints.push_back(ppCstr);
+    if(_p->data() == &m_nonUniformParticleData)
+        return -1 - _p->index();
+    return _p->index();
 }
 
-void DynamicsWorld::addFrictionConstraint(const ParticlePtr _p1, const ParticlePtr _p2)
+ParticlePtr DynamicsWorld::particleFromKey(int _key) const
 {
-    auto fCstr = std::make_shared<FrictionConstraint>(_p1, _p2);
-    _p1->m_CollisionConstraints.push_back(fCstr);
-    _p2->m_CollisionConstraints.push_back(fCstr);
-
+    if(_key < 0)
+    {
+        int idx = -1 - _key;
+        return idx < int(m_NonUniformParticles.size()) ? m_NonUniformParticles[idx] : nullptr;
+    }
+    return _key < int(m_Particles.size()) ? m_Particles[_key] : nullptr;
 }
 
-void DynamicsWorld::addHalfSpaceFrictionConstraint(const ParticlePtr _p1, const QVector3D _o, const QVector3D _n)
+// one pin per particle, pinning it again moves the pin
+void DynamicsWorld::pinParticle(int _key, const QVector3D &_pos)
 {
-    auto fCstr = std::make_shared<HalfSpaceFrictionConstraint>(_p1, QVector3D(0,0,0), QVector3D(0,1,0));
-    _p1->m_CollisionConstraints.push_back(fCstr);
-}
+    ParticlePtr p = particleFromKey(_key);
+    if(!p)
+        return;
 
-void DynamicsWorld::addHalfSpacePreConditionConstraint(const ParticlePtr _p1, const QVector3D _qc, const QVector3D _planeNormal)
-{
-    auto HsPreCCstr = std::make_shared<HalfSpacePreConditionConstraint>(_p1, _qc, _planeNormal);
-    _p1->m_PreConditionConstraints.push_back(HsPreCCstr);
+    for(auto &c : m_PinConstraints)
+    {
+        if(c->getParticle() == p)
+        {
+            c->setPositon(_pos);
+            return;
+        }
+    }
+    addPinConstraint(p, _pos);
 }
 
-void DynamicsWorld::deleteConstraint(const ConstraintPtr _constraint)
+void DynamicsWorld::unpinParticle(int _key)
 {
-    for(auto p : _constraint->m_Particles)
+    ParticlePtr p = particleFromKey(_key);
+    if(!p)
+        return;
+
+    for(auto &c : m_PinConstraints)
     {
-        if(auto particle = p.lock())
+        if(c->getParticle() == p)
         {
-            std::vector< ConstraintWeakPtr>::const_iterator it = particle->m_Constraints.begin();
-            std::vector< ConstraintWeakPtr>::const_iterator itEnd = particle->m_Constraints.end();
-            for(it; it != itEnd; ++it)
-            {
-                if(it->lock() == _constraint)
-                {
-                    particle->m_Constraints.erase(it);
-                }
-            }
+            deleteConstraint(c);
+            return;
         }
     }
-    m_Constraints.erase(
-                std::remove_if(
-                    m_Constraints.begin(),
-                    m_Constraints.end(),
-                    [&](const ConstraintPtr c){return c == _constraint;}),
-                m_Constraints.end()
-                );
-
 }
 
-
-Eigen::Matrix3f QMatrix3toEigen(const QMatrix3x3 &_qMat)
+void DynamicsWorld::setCollisionLayer(int _key, uint32_t _layer, uint32_t _mask)
 {
-    Eigen::Matrix3f mat;
-    mat(0,0) = _qMat(0,0); mat(0,1) = _qMat(0,1); mat(0,2) = _qMat(0,2);
-    mat(1,0) = _qMat(1,0); mat(1,1) = _qMat(1,1); mat(1,2) = _qMat(1,2);
-    mat(2,0) = _qMat(2,0); mat(2,1) = _qMat(2,1); mat(2,2) = _qMat(2,2);
-    return mat;
+    if(ParticlePtr p = particleFromKey(_key))
+        p->setCollisionLayer(_layer, _mask);
 }
 
-QMatrix3x3 EigenMatrix3toQt(const Eigen::Matrix3f &_eMat)
+void DynamicsWorld::addPinTogetherConstraint(const std::vector<int> &_keys)
 {
-    QMatrix3x3 mat;
-    mat(0,0) = _eMat(0,0); mat(0,1) = _eMat(0,1); mat(0,2) = _eMat(0,2);
-    mat(1,0) = _eMat(1,0); mat(1,1) = _eMat(1,1); mat(1,2) = _eMat(1,2);
-    mat(2,0) = _eMat(2,0); mat(2,1) = _eMat(2,1); mat(2,2) = _eMat(2,2);
-    return mat;
+    std::vector<ParticlePtr> particles;
+    for(int key : _keys)
+    {
+        if(ParticlePtr p = particleFromKey(key))
+            particles.push_back(p);
+    }
+    if(particles.size() > 1)
+        addPinTogetherConstraint(particles);
 }
 
+// deleting erases from the particles list, so a copy is walked
+void DynamicsWorld::deletePinTogetherConstraints(int _key)
+{
+    ParticlePtr p = particleFromKey(_key);
+    if(!p)
+        return;
 
+    std::vector<ConstraintWeakPtr> constraints = p->m_Constraints;
+    for(auto c : constraints)
+    {
+        ConstraintPtr constraint = c.lock();
+        if(constraint && constraint->type() == AbstractConstraint::PINTOGETHER)
+        {
+            deleteConstraint(constraint);
+        }
+    }
+}
 
+// constant time but for the constraint lists of its particles
+void DynamicsWorld::deleteConstraint(const ConstraintPtr _constraint)
+{
+    for(auto p : _constraint->m_Particles)
+    {
+        if(auto particle = p.lock())
+        {
+            std::vector<ConstraintWeakPtr> &constraints = particle->m_Constraints;
+            constraints.erase(
+                        std::remove_if(
+                            constraints.begin(),
+                            constraints.end(),
+                            [&](const ConstraintWeakPtr &c){ return c.lock() == _constraint; }),
+                        constraints.end());
+        }
+    }
+    switch(_constraint->type())
+    {
+        case AbstractConstraint::PIN:
+            m_PinConstraints.remove(_constraint->m_handle);
+            break;
+        case AbstractConstraint::PINTOGETHER:
+            m_PinTogetherConstraints.remove(_constraint->m_handle);
+            break;
+        case AbstractConstraint::SHAPEMATCH:
+        case AbstractConstraint::SHAPEMATCH_RIGID:
+            if(m_ShapeMatchingConstraints.remove(_constraint->m_handle))
+                m_coloringDirty = true;
+            break;
+        case AbstractConstraint::DISTANCE:
+            deleteDistanceConstraint(_constraint->m_handle);
+            break;
+        default:
+            break;
+    }
+}
 
-
-
-
-
-
-
-
-
+// the last constraint takes the place of the torn one in the batch and in
+// its color, nothing is recolored
+bool DynamicsWorld::deleteDistanceConstraint(SlotHandle _handle)
+{
+    int hole = m_DistanceConstraints.remove(_handle);
+    if(hole < 0)
+        return false;
+
+    if(!m_coloringDirty)
+        m_DistanceColoring.remove(hole, int(m_DistanceConstraints.size()));
+    m_distanceVersion++;
+    return true;
+}
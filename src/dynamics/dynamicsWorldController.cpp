@@ -1,5 +1,7 @@
 #include "dynamics/dynamicsWorldController.h"
 
+#include <algorithm>
+
 #include "dynamics/dynamicsWorld.h"
 
 DynamicsWorldController::DynamicsWorldController()
@@ -12,23 +14,19 @@ DynamicsWorldController::DynamicsWorldController(DynamicsWorld *_dynamics)
     m_dynamicsWorld = _dynamics;
 }
 
+// the world may step on its own thread, every edit is posted to it and
+// runs before its next step
+
 void DynamicsWorldController::startStopSim()
 {
-    if(m_simulating)
-    {
-        m_dynamicsWorld->setSimulate(false);
-        m_simulating = false;
-    }
-    else
-    {
-        m_dynamicsWorld->setSimulate(true);
-        m_simulating = true;
-    }
+    m_simulating = !m_simulating;
+    bool simulate = m_simulating;
+    m_dynamicsWorld->post([simulate](DynamicsWorld &_world){ _world.setSimulate(simulate); });
 }
 
 void DynamicsWorldController::stepSim()
 {
-    m_dynamicsWorld->step();
+    m_dynamicsWorld->post([](DynamicsWorld &_world){ _world.step(); });
 }
 
 
@@ -40,45 +38,93 @@ void DynamicsWorldController::resetSim()
 
 void DynamicsWorldController::setGravityY(float _y)
 {
-    m_dynamicsWorld->m_gravity.setY(_y);
+    m_dynamicsWorld->post([_y](DynamicsWorld &_world){ _world.m_gravity.setY(_y); });
 }
 
 void DynamicsWorldController::setTimeStepSize(float _ts)
 {
-       m_dynamicsWorld->m_dt = _ts;
+    m_dynamicsWorld->post([_ts](DynamicsWorld &_world){ _world.m_dt = _ts; });
 }
 
 void DynamicsWorldController::setPreConditionIteration(int _pciter)
 {
-    m_dynamicsWorld->m_preConditionIteration = _pciter;
+    m_dynamicsWorld->post([_pciter](DynamicsWorld &_world){ _world.m_preConditionIteration = _pciter; });
 }
 
 void DynamicsWorldController::setConstraintIteration(int _citer)
 {
-    m_dynamicsWorld->m_constraintIteration = _citer;
+    m_dynamicsWorld->post([_citer](DynamicsWorld &_world){ _world.m_constraintIteration = _citer; });
+}
+
+// 1 runs the iterations on the whole step, more runs one per substep
+void DynamicsWorldController::setSubsteps(int _substeps)
+{
+    int substeps = std::max(1, _substeps);
+    m_dynamicsWorld->post([substeps](DynamicsWorld &_world){ _world.m_substeps = substeps; });
+}
+
+void DynamicsWorldController::setMaxStepsPerFrame(int _maxSteps)
+{
+    m_dynamicsWorld->post([_maxSteps](DynamicsWorld &_world){ _world.setMaxStepsPerFrame(_maxSteps); });
+}
+
+// 0: Gauss-Seidel, 1: Jacobi, anything else is ignored
+void DynamicsWorldController::setSolver(int _solver)
+{
+    if(_solver != DynamicsWorld::GAUSS_SEIDEL && _solver != DynamicsWorld::JACOBI)
+        return;
+    DynamicsWorld::SolverType solver = DynamicsWorld::SolverType(_solver);
+    m_dynamicsWorld->post([solver](DynamicsWorld &_world){ _world.m_solverType = solver; });
+}
+
+// Jacobi diverges for omega of 2 and above
+void DynamicsWorldController::setOverRelaxation(float _omega)
+{
+    float omega = std::max(0.1f, std::min(_omega, 1.99f));
+    m_dynamicsWorld->post([omega](DynamicsWorld &_world){ _world.m_overRelaxation = omega; });
+}
+
+void DynamicsWorldController::setContactWarmStart(float _factor)
+{
+    m_dynamicsWorld->post([_factor](DynamicsWorld &_world){ _world.m_contactWarmStart = _factor; });
 }
 
 void DynamicsWorldController::setPBDDamping(float _damp)
 {
-    m_dynamicsWorld->m_pbdDamping = _damp;
+    m_dynamicsWorld->post([_damp](DynamicsWorld &_world){ _world.m_pbdDamping = _damp; });
 }
 
 void DynamicsWorldController::setDistanceConstraintStretch(float _stretch)
 {
-    m_dynamicsWorld->m_DistanceConstraintStretch = _stretch;
+    m_dynamicsWorld->post([_stretch](DynamicsWorld &_world){ _world.setAllDistanceConstraintStretch(_stretch); });
 }
 
 void DynamicsWorldController::setDistanceConstraintCompress(float _compress)
 {
-    m_dynamicsWorld->m_distanceConstraintCompress = _compress;
+    m_dynamicsWorld->post([_compress](DynamicsWorld &_world){ _world.setAllDistanceConstraintCompress(_compress); });
+}
+
+void DynamicsWorldController::setDistanceConstraintCompliance(float _compliance)
+{
+    m_dynamicsWorld->post([_compliance](DynamicsWorld &_world){ _world.setAllDistanceConstraintCompliance(_compliance); });
+}
+
+void DynamicsWorldController::setShapeMatchingCompliance(float _compliance)
+{
+    m_dynamicsWorld->post([_compliance](DynamicsWorld &_world){ _world.setAllShapeMatchingCompliance(_compliance); });
+}
+
+void DynamicsWorldController::setBendingCompliance(float _compliance)
+{
+    m_dynamicsWorld->post([_compliance](DynamicsWorld &_world){ _world.setAllBendingCompliance(_compliance); });
 }
 
 void DynamicsWorldController::setShapeMatchingConstraintAttract(float _attract)
 {
-    m_dynamicsWorld->m_shapeMatchAttract = _attract;
+    m_dynamicsWorld->post([_attract](DynamicsWorld &_world){ _world.m_shapeMatchAttract = _attract; });
 }
 
 void DynamicsWorldController::setParticleMass(float _mass)
 {
-    m_dynamicsWorld->setAllParticlesMass(_mass);
+    m_dynamicsWorld->post([_mass](DynamicsWorld &_world){ _world.setAllParticlesMass(_mass); });
 }
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+
+#include "dynamics/dynamicsWorld.h"
+#include "parameters.h"
+#include "sceneobject.h"
+
+// the parts of the world that build bodies from scene objects. They need the
+// model and scene object code, so they are left out of the headless library.
+// Particles, rigid grids, colliders and static meshes can be posted as
+// commands, the scene objects are made dynamic by the render thread at its
+// next present().
+// Rigid and soft bodies clone their model into new vertex buffers and have
+// to be added on the render thread, with the world paused.
+
+void DynamicsWorld::addDynamicObject(pSceneOb _sceneObject)
+{
+
+}
+
+DynamicObjectPtr DynamicsWorld::addDynamicObjectAsParticle(pSceneOb _sceneObject)
+{
+    auto pParticle = addParticle(_sceneObject->getPos());
+    pParticle->setBodyID(pCount);
+    pParticle->setRadius(_sceneObject->getRadius());
+//    pParticle->setMass(0);
+    mlog<<"New Particle: "<<pParticle->w()<<" ID: "<<pParticle->ID() ;
+//    SingleParticle pDynamicObject(pParticle);
+    std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(pParticle);
+    pDynamicObject->mID = pCount;
+    m_DynamicObjects.push_back(pDynamicObject);
+    postToRenderer([_sceneObject, pDynamicObject](){ _sceneObject->makeDynamic(pDynamicObject); });
+    // std::move (?)
+    return pDynamicObject;
+}
+
+DynamicObjectPtr DynamicsWorld::addDynamicObjectAsRigidBody(pSceneOb _sceneObject, int color)
+{
+    if(!_sceneObject->model())
+        return nullptr;
+
+    // clones it's own model object with all data. (cause model will me deformed)
+    auto nRB = std::make_shared<RigidBody>(_sceneObject->model());
+    objectCount++;
+    ModelPtr model = nRB->getModel();
+    _sceneObject->setModel(nRB->getModel());
+
+    for(unsigned int i = 0; i < model->getNumShapes(); i++)
+    {
+        ShapePtr shape = model->getShape(i);
+        for(auto point : shape->getPoints())
+        {
+            QVector3D pos = _sceneObject->getMatrix() * point;
+            auto nParticle = addParticle(pos, objectCount);
+            nParticle->setRadius(_sceneObject->getRadius());
+
+            nParticle->setMass(0.1);
+
+            nRB->addParticle(point, nParticle);
+
+            notifyParticleAdded(nParticle, color);
+        }
+    }
+    auto smCstr = nRB->createConstraint();
+    smCstr->setCompliance(m_shapeMatchingCompliance);
+    smCstr->setRotationMethod(m_shapeMatchingRotation);
+    smCstr->m_handle = m_ShapeMatchingConstraints.insert(smCstr);
+    m_coloringDirty = true;
+
+    m_DynamicObjects.push_back(nRB);
+
+    nRB->updateModelBuffers();
+    _sceneObject->makeDynamic(nRB);
+
+    return nRB;
+}
+
+void DynamicsWorld::addDynamicObjectAsRigidBodyGrid(pSceneOb _sceneObject, std::string _path, int _color)
+{
+    FILE * file = std::fopen(_path.c_str(), "r");
+    if( file == nullptr ){
+        mlog<<"Impossible to open the file !\n";
+        return;
+    }
+
+    std::vector<QVector3D> verts;
+    std::vector<QVector3D> normals;
+
+    while( 1 ){
+
+        char lineHeader[128];
+        // read the first word of the line
+        int res = fscanf(file, "%s", lineHeader);
+        if (res == EOF)
+            break; // EOF = End Of File. Quit the loop.
+
+
+        if ( std::strcmp( lineHeader, "v" ) == 0 ){
+            float x,y,z;
+            fscanf(file, "%f %f %f\n", &x, &y, &z );
+            verts.push_back(QVector3D(x,y,z));
+        // else : parse lineHeader
+        }
+
+        if ( std::strcmp( lineHeader, "vn" ) == 0 ){
+            float x,y,z;
+            fscanf(file, "%f %f %f\n", &x, &y, &z );
+            normals.push_back(QVector3D(x,y,z));
+        // else : parse lineHeader
+        }
+    }
+
+    std::fclose(file);
+
+    if(normals.size() != verts.size())
+        mlog<<"warning -------verts are not normals";
+
+    auto nRBG = addRigidBodyGrid(verts, normals, _sceneObject->getMatrix(), _color);
+    postToRenderer([_sceneObject, nRBG](){ _sceneObject->makeDynamic(nRBG); });
+}
+
+// every shape of the model, placed by the scene objects matrix. The scene
+// object stays as it is, the geometry is copied.
+void DynamicsWorld::addStaticObjectAsTriangleMesh(pSceneOb _sceneObject, uint32_t _layer, uint32_t _layerMask)
+{
+    ModelPtr model = _sceneObject->model();
+    if(!model)
+        return;
+
+    QMatrix4x4 transform = _sceneObject->getMatrix();
+    for(int i=0; i < model->getNumShapes(); i++)
+    {
+        ShapePtr shape = model->getShape(i);
+        std::vector<QVector3D> vertices;
+        vertices.reserve(shape->getVertices().size());
+        for(const Vertex &v : shape->getVertices())
+            vertices.push_back(transform * v.Position);
+        addTriangleMesh(vertices, shape->getIndices(), _layer, _layerMask);
+    }
+}
+
+// all shapes of the model as one mesh in model space
+static void modelMesh(ModelPtr _model, std::vector<QVector3D> &_vertices, std::vector<unsigned int> &_indices)
+{
+    for(int i=0; i < _model->getNumShapes(); i++)
+    {
+        ShapePtr shape = _model->getShape(i);
+        unsigned int offset = _vertices.size();
+        for(const Vertex &v : shape->getVertices())
+            _vertices.push_back(v.Position);
+        for(unsigned int idx : shape->getIndices())
+            _indices.push_back(offset + idx);
+    }
+}
+
+// the model has to be closed, its inside is what the border can't reach
+void DynamicsWorld::addStaticObjectAsSdf(pSceneOb _sceneObject, float _cellSize, uint32_t _layer, uint32_t _layerMask)
+{
+    ModelPtr model = _sceneObject->model();
+    if(!model)
+        return;
+
+    std::vector<QVector3D> vertices;
+    std::vector<unsigned int> indices;
+    modelMesh(model, vertices, indices);
+
+    QMatrix4x4 transform = _sceneObject->getMatrix();
+    float scale = transform.mapVector(QVector3D(1,0,0)).length();
+    auto field = std::make_shared<SignedDistanceField>();
+    field->bakeCached(vertices, indices, _cellSize, sdfBand / scale, sdfCacheDirectory);
+    addSdfCollider(field, transform, _layer, _layerMask);
+}
+
+DynamicsWorld::ModelMeshPtr DynamicsWorld::meshOfModel(ModelPtr _model)
+{
+    auto mesh = std::make_shared<ModelMesh>();
+    if(_model)
+        modelMesh(_model, mesh->vertices, mesh->indices);
+    return mesh;
+}
+
+// the volume samples the rigid grids were read from files of before, with
+// the band reaching the middle every sample has a gradient
+void DynamicsWorld::addDynamicObjectAsSdfRigidBodyGrid(pSceneOb _sceneObject, ModelMeshPtr _mesh,
+                                                       const QMatrix4x4 &_transform, float _spacing, int _color)
+{
+    if(!_mesh || _mesh->vertices.empty())
+        return;
+
+    const SdfSamples *samples = nullptr;
+    for(const SdfSamples &s : m_sdfSamples)
+    {
+        if(s.mesh == _mesh && s.spacing == _spacing)
+            samples = &s;
+    }
+
+    if(!samples)
+    {
+        const std::vector<QVector3D> &vertices = _mesh->vertices;
+        QVector3D min = vertices[0];
+        QVector3D max = vertices[0];
+        for(const QVector3D &v : vertices)
+        {
+            min = QVector3D(std::min(min.x(), v.x()), std::min(min.y(), v.y()), std::min(min.z(), v.z()));
+            max = QVector3D(std::max(max.x(), v.x()), std::max(max.y(), v.y()), std::max(max.z(), v.z()));
+        }
+        QVector3D extent = max - min;
+        float cellSize = 0.25f * _spacing;
+        float band = 0.5f * std::min({extent.x(), extent.y(), extent.z()}) + cellSize;
+
+        SignedDistanceField field;
+        field.bakeCached(vertices, _mesh->indices, cellSize, band, sdfCacheDirectory);
+
+        SdfSamples s;
+        s.mesh = _mesh;
+        s.spacing = _spacing;
+        field.sampleInterior(_spacing, s.points, s.gradients);
+        m_sdfSamples.push_back(s);
+        samples = &m_sdfSamples.back();
+    }
+
+    // thinner than the spacing, nothing was sampled
+    if(samples->points.empty())
+        return;
+    auto nRBG = addRigidBodyGrid(samples->points, samples->gradients, _transform, _color);
+    postToRenderer([_sceneObject, nRBG](){ _sceneObject->makeDynamic(nRBG); });
+}
+
+DynamicObjectPtr DynamicsWorld::addDynamicObjectAsNonUniformParticle(pSceneOb _sceneObject, float radius)
+{
+    pCount++;
+    int idx = m_nonUniformParticleData.add(_sceneObject->getPos(), 0);
+    auto nParticle = std::make_shared<Particle>(&m_nonUniformParticleData, idx);
+    nParticle->setRadius(radius);
+    m_NonUniformParticles.push_back(nParticle);
+    std::shared_ptr<SingleParticle> pDynamicObject = std::make_shared<SingleParticle>(nParticle);
+    postToRenderer([_sceneObject, pDynamicObject](){ _sceneObject->makeDynamic(pDynamicObject); });
+
+    nParticle->setID(991);
+
+    return pDynamicObject;
+}
+
+
+DynamicObjectPtr DynamicsWorld::addDynamicObjectAsSoftBody(pSceneOb _sceneObject, float _mass)
+{
+    if(!_sceneObject->model())
+        return nullptr;
+
+     auto nSB = std::make_shared<SoftBody>(_sceneObject->model());
+     objectCount++;
+     ModelPtr model = nSB->getModel();
+      _sceneObject->setModel(nSB->getModel());
+
+     for(unsigned int i = 0; i < model->getNumShapes(); i++)
+     {
+         ShapePtr shape = model->getShape(i);
+         for(auto point : shape->getPoints())
+         {
+             QVector3D pos = _sceneObject->getMatrix() * point;
+             auto nParticle = addParticle(pos, objectCount);
+             nSB->addParticle(point, nParticle);
+
+             notifyParticleAdded(nParticle);
+         }
+     }
+     MeshEdges edges = nSB->createConstraintNetwork();
+     std::vector<ParticleWeakPtr> &particles = nSB->getParticles();
+     for(const MeshEdges::Edge &e : edges.edges())
+         addDistanceEqualityConstraint(particles[e.first].lock(), particles[e.second].lock());
+     for(const MeshEdges::Edge &e : edges.bendingEdges())
+         addDistanceEqualityConstraint(particles[e.first].lock(), particles[e.second].lock(), true);
+
+     m_DynamicObjects.push_back(nSB);
+     nSB->turnOffSelfCollision();
+     nSB->updateModelBuffers();
+     _sceneObject->makeDynamic(nSB);
+     return nSB;
+}
@@ -0,0 +1,45 @@
+#include "dynamics/jacobiSolver.h"
+
+#include <omp.h>
+
+JacobiSolver::JacobiSolver()
+{
+}
+
+void JacobiSolver::resize(int _numParticles)
+{
+    int numThreads = omp_get_max_threads();
+    if(int(m_delta.size()) == numThreads && !m_delta.empty() && int(m_delta[0].size()) == _numParticles)
+        return;
+
+    m_delta.resize(numThreads);
+    m_count.resize(numThreads);
+    for(int t=0; t < numThreads; t++)
+    {
+        m_delta[t].assign(_numParticles, QVector3D(0,0,0));
+        m_count[t].assign(_numParticles, 0.0f);
+    }
+}
+
+void JacobiSolver::apply(ParticleData &_particles, float _overRelaxation)
+{
+    int numThreads = int(m_delta.size());
+    int numParticles = int(_particles.size());
+
+    #pragma omp parallel for
+    for(int i=0; i < numParticles; i++)
+    {
+        QVector3D delta(0,0,0);
+        float count = 0;
+        for(int t=0; t < numThreads; t++)
+        {
+            delta += m_delta[t][i];
+            count += m_count[t][i];
+            m_delta[t][i] = QVector3D(0,0,0);
+            m_count[t][i] = 0;
+        }
+
+        if(count > 0)
+            _particles.p[i] += (_overRelaxation / count) * delta;
+    }
+}
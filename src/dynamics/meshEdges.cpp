@@ -0,0 +1,103 @@
+#include "dynamics/meshEdges.h"
+
+#include <algorithm>
+
+namespace
+{
+// an edge of one triangle and the point across from it
+struct HalfEdge
+{
+    int a, b;
+    int opposite;
+
+    bool operator<(const HalfEdge &_other) const
+    {
+        if(a != _other.a)
+            return a < _other.a;
+        if(b != _other.b)
+            return b < _other.b;
+        return opposite < _other.opposite;
+    }
+};
+
+MeshEdges::Edge makeEdge(int _a, int _b)
+{
+    return _a < _b ? MeshEdges::Edge(_a, _b) : MeshEdges::Edge(_b, _a);
+}
+}
+
+MeshEdges::MeshEdges()
+{
+}
+
+void MeshEdges::build(const std::map<int, std::list<int>> &_pointsToVerts, const std::vector<unsigned int> &_indices)
+{
+    m_edges.clear();
+    m_bending.clear();
+
+    int numVerts = 0;
+    for(const auto &point : _pointsToVerts)
+    {
+        for(int v : point.second)
+            numVerts = std::max(numVerts, v + 1);
+    }
+
+    std::vector<int> vertToPoint(numVerts, -1);
+    for(const auto &point : _pointsToVerts)
+    {
+        for(int v : point.second)
+            vertToPoint[v] = point.first;
+    }
+
+    std::vector<HalfEdge> halfEdges;
+    halfEdges.reserve(_indices.size());
+    for(size_t i=2; i < _indices.size(); i+=3)
+    {
+        int p[3];
+        bool valid = true;
+        for(int j=0; j < 3; j++)
+        {
+            unsigned int v = _indices[i - 2 + j];
+            p[j] = v < vertToPoint.size() ? vertToPoint[v] : -1;
+            valid = valid && p[j] >= 0;
+        }
+        // welded away
+        if(!valid || p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+            continue;
+
+        for(int j=0; j < 3; j++)
+        {
+            Edge e = makeEdge(p[j], p[(j + 1) % 3]);
+            halfEdges.push_back(HalfEdge{e.first, e.second, p[(j + 2) % 3]});
+        }
+    }
+    std::sort(halfEdges.begin(), halfEdges.end());
+
+    // one run per edge, its triangles pair up into bending edges
+    for(size_t begin=0, end=0; begin < halfEdges.size(); begin = end)
+    {
+        const HalfEdge &h = halfEdges[begin];
+        end = begin + 1;
+        while(end < halfEdges.size() && halfEdges[end].a == h.a && halfEdges[end].b == h.b)
+            end++;
+
+        m_edges.push_back(Edge(h.a, h.b));
+        for(size_t i=begin; i < end; i++)
+        {
+            for(size_t j=i+1; j < end; j++)
+            {
+                if(halfEdges[i].opposite != halfEdges[j].opposite)
+                    m_bending.push_back(makeEdge(halfEdges[i].opposite, halfEdges[j].opposite));
+            }
+        }
+    }
+
+    std::sort(m_bending.begin(), m_bending.end());
+    m_bending.erase(std::unique(m_bending.begin(), m_bending.end()), m_bending.end());
+    m_bending.erase(
+                std::remove_if(
+                    m_bending.begin(),
+                    m_bending.end(),
+                    [this](const Edge &e){ return std::binary_search(m_edges.begin(), m_edges.end(), e); }),
+                m_bending.end());
+}
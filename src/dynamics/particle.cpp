@@ -1,56 +1,53 @@
 #include "dynamics/particle.h"
 
-#include "parameters.h"
 
-Particle::Particle()
+Particle::Particle(ParticleData *_data, int _index) :
+    m_data(_data),
+    m_index(_index)
 {
-    collisionVector = QVector3D(0,0,0);
 }
 
-Particle::Particle(float _x, float _y, float _z, int _ID)
+void Particle::setRadius(float _radius)
 {
-    r = 0.5;
-    m = particleMass;
-    x = QVector3D(_x, _y, _z);
-    p = x;
-    v = QVector3D(0, 0, 0);
-    w = 1.0 / m;
-    if(isinf(w) || w < 0)
-        w = 0;
-    collisionVector = QVector3D(0,0,0);
+    m_data->r[m_index] = _radius;
 }
 
-void Particle::setRadius(float _radius)
+void Particle::setMass(float _mass)
 {
-    r = _radius;
+    m_data->setMass(m_index, _mass);
 }
 
-void Particle::setMass(float _mass)
+void Particle::setID(int _ID)
+{
+    m_data->ID[m_index] = _ID;
+}
+
+void Particle::setBodyID(int _bodyID)
+{
+    m_data->bodyID[m_index] = _bodyID;
+}
+
+void Particle::setCollisionGroup(uint32_t _group, uint32_t _mask)
 {
-    if(_mass <= 0){
-        w = 0;
-        m = 0;
-        return;
-    }
-    m = _mass;
-    w = 1/_mass;
+    m_data->group[m_index] = _group;
+    m_data->groupMask[m_index] = _mask;
 }
 
-void Particle::setCell(int _i, int _j, int _k)
+void Particle::setCollisionLayer(uint32_t _layer, uint32_t _mask)
 {
-    cell.i = _i;
-    cell.j = _j;
-    cell.k = _k;
+    m_data->layer[m_index] = _layer;
+    m_data->layerMask[m_index] = _mask;
 }
 
-void Particle::setHash(size_t _hashv)
+void Particle::setCollisionGradient(float _length, const QVector3D &_dir)
 {
-    hash = _hashv;
+    m_data->collisionGradLen[m_index] = _length;
+    m_data->collisionVector[m_index] = _dir;
 }
 
 float Particle::mass()
 {
-    return m;
+    return m_data->m[m_index];
 }
 
 ParticlePtr Particle::pointer(Particle *ptr)
@@ -75,16 +72,17 @@ void Particle::pointer(Particle **_ptr)
 
 const QMatrix4x4 Particle::getTransfrom()
 {
+    float r = renderRadius();
     QMatrix4x4 mat;
     mat.setToIdentity();
     mat.scale(QVector3D(2*r, 2*r, 2*r));
-    mat(0,3) = x.x();
-    mat(1,3) = x.y();
-    mat(2,3) = x.z();
+    mat(0,3) = renderPosition().x();
+    mat(1,3) = renderPosition().y();
+    mat(2,3) = renderPosition().z();
     return mat;
 }
 
 const QVector3D Particle::getTranslation()
 {
-    return x;
+    return renderPosition();
 }
@@ -0,0 +1,78 @@
+#include "dynamics/particleData.h"
+
+ParticleData::ParticleData()
+{
+}
+
+int ParticleData::add(const QVector3D &_pos, float _mass)
+{
+    int idx = int(x.size());
+    x.push_back(_pos);
+    p.push_back(_pos);
+    v.push_back(QVector3D(0,0,0));
+    w.push_back(0);
+    m.push_back(0);
+    r.push_back(0.5);
+    ID.push_back(0);
+    bodyID.push_back(0);
+    group.push_back(1);
+    groupMask.push_back(0);
+    layer.push_back(1);
+    layerMask.push_back(0xffffffff);
+    collisionGradLen.push_back(0);
+    collisionVector.push_back(QVector3D(0,0,0));
+    collisionNormal.push_back(QVector3D(0,0,0));
+    setMass(idx, _mass);
+    return idx;
+}
+
+void ParticleData::reserve(size_t _n)
+{
+    x.reserve(_n);
+    p.reserve(_n);
+    v.reserve(_n);
+    w.reserve(_n);
+    m.reserve(_n);
+    r.reserve(_n);
+    ID.reserve(_n);
+    bodyID.reserve(_n);
+    group.reserve(_n);
+    groupMask.reserve(_n);
+    layer.reserve(_n);
+    layerMask.reserve(_n);
+    collisionGradLen.reserve(_n);
+    collisionVector.reserve(_n);
+    collisionNormal.reserve(_n);
+}
+
+void ParticleData::clear()
+{
+    x.clear();
+    p.clear();
+    v.clear();
+    xRender.clear();
+    w.clear();
+    m.clear();
+    r.clear();
+    rRender.clear();
+    ID.clear();
+    bodyID.clear();
+    group.clear();
+    groupMask.clear();
+    layer.clear();
+    layerMask.clear();
+    collisionGradLen.clear();
+    collisionVector.clear();
+    collisionNormal.clear();
+}
+
+void ParticleData::setMass(int _idx, float _mass)
+{
+    if(_mass <= 0){
+        w[_idx] = 0;
+        m[_idx] = 0;
+        return;
+    }
+    m[_idx] = _mass;
+    w[_idx] = 1/_mass;
+}
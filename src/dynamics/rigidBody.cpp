@@ -1,4 +1,5 @@
 #include "include/dynamics/RigidBody.h"
+#include "model.h"
 
 RigidBody::RigidBody()
 {
@@ -19,7 +20,7 @@ void RigidBody::addParticle(const QVector3D &_localPos, const ParticleWeakPtr _p
     m_restShape.push_back(_localPos);
 }
 
-ConstraintPtr RigidBody::createConstraint()
+std::shared_ptr<ShapeMatchingConstraint> RigidBody::createConstraint()
 {
     auto smCstr = std::make_shared<ShapeMatchingConstraint>(this);
     std::weak_ptr<ShapeMatchingConstraint> smCstrWeak = smCstr;
@@ -28,14 +29,6 @@ ConstraintPtr RigidBody::createConstraint()
         if(auto particle = p.lock())
         {
             particle->m_Constraints.push_back(smCstrWeak);
-            for_each(m_particles.begin(), m_particles.end(), [&particle](ParticleWeakPtr pNeighbour)
-            {
-                if(particle != pNeighbour.lock())
-                {
-                    std::shared_ptr<Particle> sharedNeighbour = pNeighbour.lock();
-                    particle->m_NonCollisionParticles.push_back(sharedNeighbour);
-                }
-            });
         }
     }
     return smCstr;
@@ -59,7 +52,11 @@ void RigidBody::updateModelBuffers()
         ShapePtr shape = m_model->getShape(i);
         for(int i=0; i < shape->getVertsMap().size();  i++)
         {
-            QVector3D position = m_particles[i].lock()->getTranslation();
+            // left where the model put it until the particle is presented
+            ParticlePtr particle = m_particles[i].lock();
+            if(!particle->presented())
+                continue;
+            QVector3D position = particle->getTranslation();
             for(auto vertIdx : shape->getVertsMap()[i])
             {
                 shape->setVertexPositionAtIndex(vertIdx, position);
@@ -17,7 +17,7 @@ void RigidBodyGrid::addParticle(const QVector3D &_localPos, const ParticleWeakPt
     m_restShape.push_back(_localPos);
 }
 
-ConstraintPtr RigidBodyGrid::createConstraint()
+std::shared_ptr<ShapeMatchingConstraint> RigidBodyGrid::createConstraint()
 {
     auto smCstr = std::make_shared<ShapeMatchingConstraint>(this);
     std::weak_ptr<ShapeMatchingConstraint> smCstrWeak = smCstr;
@@ -26,15 +26,6 @@ ConstraintPtr RigidBodyGrid::createConstraint()
         if(auto particle = p.lock())
         {
             particle->m_Constraints.push_back(smCstrWeak);
-            for_each(m_particles.begin(), m_particles.end(), [&particle](ParticleWeakPtr pNeighbour)
-            {
-                if(particle != pNeighbour.lock())
-                {
-                    std::shared_ptr<Particle> sharedNeighbour = pNeighbour.lock();
-                    particle->m_NonCollisionParticles.push_back(sharedNeighbour);
-//                    particle->m_NonCollisionParticles.push_back(pNeighbour);
-                }
-            });
         }
     }
     return smCstr;
@@ -59,7 +50,7 @@ void RigidBodyGrid::updateModelBuffers()
 const QMatrix4x4 RigidBodyGrid::getTransfrom()
 {
 
-    return  m_t;
+    return  m_renderT;
 }
 
 const QVector3D RigidBodyGrid::getTranslation()
@@ -67,6 +58,32 @@ const QVector3D RigidBodyGrid::getTranslation()
     return QVector3D(0,0,0);
 }
 
+const QMatrix4x4 &RigidBodyGrid::transform() const
+{
+    return m_t;
+}
+
+void RigidBodyGrid::keepPreviousTransform()
+{
+    m_previousT = m_t;
+    m_hasPreviousT = true;
+}
+
+bool RigidBodyGrid::hasPreviousTransform() const
+{
+    return m_hasPreviousT;
+}
+
+const QMatrix4x4 &RigidBodyGrid::previousTransform() const
+{
+    return m_previousT;
+}
+
+void RigidBodyGrid::setRenderTransform(const QMatrix4x4 &_t)
+{
+    m_renderT = _t;
+}
+
 std::vector<ParticleWeakPtr> &RigidBodyGrid::getParticles()
 {
     return m_particles;
@@ -0,0 +1,467 @@
+#include "dynamics/signedDistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "dynamics/triangleMeshCollider.h"
+
+namespace
+{
+// a node of an allocated brick no triangle came close to yet
+const float unset = std::numeric_limits<float>::max();
+const char magic[8] = "PBDSDF1";
+
+bool positionLess(const QVector3D &_a, const QVector3D &_b)
+{
+    if(_a.x() != _b.x())
+        return _a.x() < _b.x();
+    if(_a.y() != _b.y())
+        return _a.y() < _b.y();
+    return _a.z() < _b.z();
+}
+
+float angle(const QVector3D &_u, const QVector3D &_v)
+{
+    float d = QVector3D::dotProduct(_u.normalized(), _v.normalized());
+    return std::acos(std::max(-1.0f, std::min(1.0f, d)));
+}
+
+// an edge of one triangle, by its welded points
+struct HalfEdge
+{
+    int a, b;
+    int slot;   // 3 * triangle + edge
+
+    bool operator<(const HalfEdge &_other) const
+    {
+        return a != _other.a ? a < _other.a : b < _other.b;
+    }
+};
+
+// a node's offset in its brick
+int brickLocal(int _i, int _j, int _k)
+{
+    const int s = SignedDistanceField::brickSize;
+    return (_i % s) + s * ((_j % s) + s * (_k % s));
+}
+
+template<typename T>
+bool readArray(FILE *_file, std::vector<T> &_values)
+{
+    uint64_t size;
+    if(std::fread(&size, sizeof(size), 1, _file) != 1)
+        return false;
+    _values.resize(size_t(size));
+    return size == 0 || std::fread(_values.data(), sizeof(T), _values.size(), _file) == _values.size();
+}
+
+template<typename T>
+void writeArray(FILE *_file, const std::vector<T> &_values)
+{
+    uint64_t size = _values.size();
+    std::fwrite(&size, sizeof(size), 1, _file);
+    if(size)
+        std::fwrite(_values.data(), sizeof(T), _values.size(), _file);
+}
+}
+
+SignedDistanceField::SignedDistanceField()
+{
+}
+
+int SignedDistanceField::brickOf(int _i, int _j, int _k) const
+{
+    return (_i / brickSize) + m_bricks[0] * ((_j / brickSize) + m_bricks[1] * (_k / brickSize));
+}
+
+float* SignedDistanceField::allocate(int _i, int _j, int _k)
+{
+    int &brick = m_brickIndex[brickOf(_i, _j, _k)];
+    if(brick < 0)
+    {
+        brick = int(m_values.size());
+        m_values.resize(m_values.size() + brickSize * brickSize * brickSize, unset);
+    }
+    return &m_values[brick + brickLocal(_i, _j, _k)];
+}
+
+float SignedDistanceField::node(int _i, int _j, int _k) const
+{
+    int brick = m_brickIndex[brickOf(_i, _j, _k)];
+    if(brick == OUTSIDE)
+        return m_band;
+    if(brick == INSIDE)
+        return -m_band;
+    return m_values[brick + brickLocal(_i, _j, _k)];
+}
+
+// The sign of a node in the band comes from the angle weighted pseudo
+// normal of the feature closest to it (Baerentzen and Aanaes 2005), the
+// mesh is welded by position first so its edges and corners are shared.
+void SignedDistanceField::bake(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                               float _cellSize, float _band)
+{
+    m_brickIndex.clear();
+    m_values.clear();
+    m_cellSize = _cellSize;
+    m_band = std::max(_band, _cellSize);
+    if(_vertices.empty() || _indices.size() < 3 || _cellSize <= 0)
+        return;
+
+    // weld
+    std::vector<int> order(_vertices.size());
+    for(size_t i=0; i < order.size(); i++)
+        order[i] = int(i);
+    std::sort(order.begin(), order.end(), [&](int _a, int _b){ return positionLess(_vertices[_a], _vertices[_b]); });
+
+    std::vector<QVector3D> points;
+    std::vector<int> vertToPoint(_vertices.size());
+    for(size_t i=0; i < order.size(); i++)
+    {
+        if(i == 0 || positionLess(_vertices[order[i-1]], _vertices[order[i]]))
+            points.push_back(_vertices[order[i]]);
+        vertToPoint[order[i]] = int(points.size()) - 1;
+    }
+
+    std::vector<int> triangles;
+    std::vector<QVector3D> faceNormals;
+    for(size_t i=2; i < _indices.size(); i+=3)
+    {
+        int a = vertToPoint[_indices[i-2]];
+        int b = vertToPoint[_indices[i-1]];
+        int c = vertToPoint[_indices[i]];
+        QVector3D n = QVector3D::crossProduct(points[b] - points[a], points[c] - points[a]);
+        if(a == b || b == c || c == a || n.length() < 1e-12f)
+            continue;
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+        faceNormals.push_back(n.normalized());
+    }
+    int numTriangles = int(faceNormals.size());
+
+    // pseudo normals of the corners and edges
+    std::vector<QVector3D> pointNormals(points.size(), QVector3D(0,0,0));
+    std::vector<HalfEdge> halfEdges;
+    for(int t=0; t < numTriangles; t++)
+    {
+        for(int e=0; e < 3; e++)
+        {
+            int p = triangles[3*t + e];
+            int next = triangles[3*t + (e + 1) % 3];
+            int previous = triangles[3*t + (e + 2) % 3];
+            pointNormals[p] += angle(points[next] - points[p], points[previous] - points[p]) * faceNormals[t];
+            halfEdges.push_back(HalfEdge{std::min(p, next), std::max(p, next), 3*t + e});
+        }
+    }
+    std::sort(halfEdges.begin(), halfEdges.end());
+    std::vector<QVector3D> edgeNormals(halfEdges.size());
+    for(size_t begin=0, end=0; begin < halfEdges.size(); begin = end)
+    {
+        QVector3D n(0,0,0);
+        for(end = begin; end < halfEdges.size() && !(halfEdges[begin] < halfEdges[end]); end++)
+            n += faceNormals[halfEdges[end].slot / 3];
+        for(size_t i=begin; i < end; i++)
+            edgeNormals[halfEdges[i].slot] = n;
+    }
+
+    // grid with a band and a cell of room around the mesh
+    QVector3D min = points[0];
+    QVector3D max = points[0];
+    for(const QVector3D &p : points)
+    {
+        min = QVector3D(std::min(min.x(), p.x()), std::min(min.y(), p.y()), std::min(min.z(), p.z()));
+        max = QVector3D(std::max(max.x(), p.x()), std::max(max.y(), p.y()), std::max(max.z(), p.z()));
+    }
+    QVector3D margin(m_band + m_cellSize, m_band + m_cellSize, m_band + m_cellSize);
+    m_min = min - margin;
+    m_max = max + margin;
+    for(int a=0; a < 3; a++)
+    {
+        m_dims[a] = int(std::ceil((m_max[a] - m_min[a]) / m_cellSize)) + 1;
+        m_bricks[a] = (m_dims[a] + brickSize - 1) / brickSize;
+    }
+    m_brickIndex.assign(size_t(m_bricks[0]) * m_bricks[1] * m_bricks[2], OUTSIDE);
+
+    for(int t=0; t < numTriangles; t++)
+    {
+        const QVector3D &a = points[triangles[3*t]];
+        const QVector3D &b = points[triangles[3*t + 1]];
+        const QVector3D &c = points[triangles[3*t + 2]];
+
+        int lo[3], hi[3];
+        for(int ax=0; ax < 3; ax++)
+        {
+            float tMin = std::min({a[ax], b[ax], c[ax]}) - m_band;
+            float tMax = std::max({a[ax], b[ax], c[ax]}) + m_band;
+            lo[ax] = std::max(0, int(std::floor((tMin - m_min[ax]) / m_cellSize)));
+            hi[ax] = std::min(m_dims[ax] - 1, int(std::ceil((tMax - m_min[ax]) / m_cellSize)));
+        }
+
+        for(int k = lo[2]; k <= hi[2]; k++)
+        for(int j = lo[1]; j <= hi[1]; j++)
+        for(int i = lo[0]; i <= hi[0]; i++)
+        {
+            QVector3D p = m_min + m_cellSize * QVector3D(i, j, k);
+            TriangleMeshCollider::Feature feature;
+            QVector3D q = TriangleMeshCollider::closestPoint(p, a, b, c, feature);
+            float dist = (p - q).length();
+            if(dist >= m_band)
+                continue;
+
+            float *value = allocate(i, j, k);
+            if(dist >= std::fabs(*value))
+                continue;
+
+            QVector3D n;
+            switch(feature)
+            {
+                case TriangleMeshCollider::FACE:     n = faceNormals[t]; break;
+                case TriangleMeshCollider::VERTEX_A: n = pointNormals[triangles[3*t]]; break;
+                case TriangleMeshCollider::VERTEX_B: n = pointNormals[triangles[3*t + 1]]; break;
+                case TriangleMeshCollider::VERTEX_C: n = pointNormals[triangles[3*t + 2]]; break;
+                case TriangleMeshCollider::EDGE_AB:  n = edgeNormals[3*t]; break;
+                case TriangleMeshCollider::EDGE_BC:  n = edgeNormals[3*t + 1]; break;
+                case TriangleMeshCollider::EDGE_CA:  n = edgeNormals[3*t + 2]; break;
+            }
+            *value = QVector3D::dotProduct(p - q, n) >= 0 ? dist : -dist;
+        }
+    }
+
+    // Nodes off the band reached from the border without crossing it are
+    // outside. Two neighbours on either side of the surface can't both be
+    // off the band, it is at least a cell wide.
+    size_t numNodes = size_t(m_dims[0]) * m_dims[1] * m_dims[2];
+    std::vector<char> outside(numNodes, 0);
+    std::vector<int> stack;
+    auto index = [&](int _i, int _j, int _k){ return _i + m_dims[0] * (_j + m_dims[1] * _k); };
+    auto visit = [&](int _i, int _j, int _k)
+    {
+        if(_i < 0 || _j < 0 || _k < 0 || _i >= m_dims[0] || _j >= m_dims[1] || _k >= m_dims[2])
+            return;
+        int n = index(_i, _j, _k);
+        int brick = m_brickIndex[brickOf(_i, _j, _k)];
+        if(outside[n] || (brick >= 0 && m_values[brick + brickLocal(_i, _j, _k)] != unset))
+            return;
+        outside[n] = 1;
+        stack.push_back(n);
+    };
+
+    for(int k=0; k < m_dims[2]; k++)
+    for(int j=0; j < m_dims[1]; j++)
+    for(int i=0; i < m_dims[0]; i++)
+    {
+        if(i == 0 || j == 0 || k == 0 || i == m_dims[0] - 1 || j == m_dims[1] - 1 || k == m_dims[2] - 1)
+            visit(i, j, k);
+    }
+    while(!stack.empty())
+    {
+        int n = stack.back();
+        stack.pop_back();
+        int i = n % m_dims[0];
+        int j = (n / m_dims[0]) % m_dims[1];
+        int k = n / (m_dims[0] * m_dims[1]);
+        visit(i-1, j, k); visit(i+1, j, k);
+        visit(i, j-1, k); visit(i, j+1, k);
+        visit(i, j, k-1); visit(i, j, k+1);
+    }
+
+    for(int k=0; k < m_dims[2]; k++)
+    for(int j=0; j < m_dims[1]; j++)
+    for(int i=0; i < m_dims[0]; i++)
+    {
+        int &brick = m_brickIndex[brickOf(i, j, k)];
+        if(brick >= 0)
+        {
+            float &value = m_values[brick + brickLocal(i, j, k)];
+            if(value == unset)
+                value = outside[index(i, j, k)] ? m_band : -m_band;
+        }
+        else if(!outside[index(i, j, k)])
+        {
+            brick = INSIDE;
+        }
+    }
+}
+
+uint64_t SignedDistanceField::meshKey(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                                      float _cellSize, float _band)
+{
+    // FNV-1a
+    uint64_t key = 14695981039346656037ull;
+    auto hash = [&key](const void *_data, size_t _size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char*>(_data);
+        for(size_t i=0; i < _size; i++)
+        {
+            key ^= bytes[i];
+            key *= 1099511628211ull;
+        }
+    };
+    hash(magic, sizeof(magic));
+    for(const QVector3D &v : _vertices)
+    {
+        float xyz[3] = {v.x(), v.y(), v.z()};
+        hash(xyz, sizeof(xyz));
+    }
+    if(!_indices.empty())
+        hash(_indices.data(), _indices.size() * sizeof(unsigned int));
+    hash(&_cellSize, sizeof(_cellSize));
+    hash(&_band, sizeof(_band));
+    return key;
+}
+
+void SignedDistanceField::bakeCached(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                                     float _cellSize, float _band, const std::string &_directory)
+{
+    uint64_t key = meshKey(_vertices, _indices, _cellSize, _band);
+    char name[32];
+    std::snprintf(name, sizeof(name), "sdf_%016llx.bin", (unsigned long long)key);
+    std::string path = _directory.empty() ? std::string(name) : _directory + "/" + name;
+
+    if(load(path) && m_key == key)
+        return;
+
+    bake(_vertices, _indices, _cellSize, _band);
+    m_key = key;
+    save(path);
+}
+
+bool SignedDistanceField::save(const std::string &_path) const
+{
+    FILE *file = std::fopen(_path.c_str(), "wb");
+    if(!file)
+        return false;
+
+    float header[8] = {m_min.x(), m_min.y(), m_min.z(), m_max.x(), m_max.y(), m_max.z(), m_cellSize, m_band};
+    std::fwrite(magic, sizeof(magic), 1, file);
+    std::fwrite(&m_key, sizeof(m_key), 1, file);
+    std::fwrite(header, sizeof(header), 1, file);
+    std::fwrite(m_dims, sizeof(m_dims), 1, file);
+    writeArray(file, m_brickIndex);
+    writeArray(file, m_values);
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    return ok;
+}
+
+bool SignedDistanceField::load(const std::string &_path)
+{
+    FILE *file = std::fopen(_path.c_str(), "rb");
+    if(!file)
+        return false;
+
+    char fileMagic[sizeof(magic)];
+    float header[8];
+    bool ok = std::fread(fileMagic, sizeof(fileMagic), 1, file) == 1 &&
+              std::memcmp(fileMagic, magic, sizeof(magic)) == 0 &&
+              std::fread(&m_key, sizeof(m_key), 1, file) == 1 &&
+              std::fread(header, sizeof(header), 1, file) == 1 &&
+              std::fread(m_dims, sizeof(m_dims), 1, file) == 1 &&
+              readArray(file, m_brickIndex) &&
+              readArray(file, m_values);
+    std::fclose(file);
+
+    // a corrupt or stale file is dropped before anything reads it
+    for(int h=0; h < 8 && ok; h++)
+        ok = std::isfinite(header[h]);
+    if(ok)
+        ok = header[6] > 0 && header[7] >= header[6];
+    for(int a=0; a < 3 && ok; a++)
+    {
+        ok = m_dims[a] > 1 && m_dims[a] < (1 << 16);
+        m_bricks[a] = ok ? (m_dims[a] + brickSize - 1) / brickSize : 0;
+    }
+    if(ok)
+        ok = m_brickIndex.size() == size_t(m_bricks[0]) * m_bricks[1] * m_bricks[2];
+    const size_t brickValues = brickSize * brickSize * brickSize;
+    for(size_t b=0; b < m_brickIndex.size() && ok; b++)
+    {
+        int brick = m_brickIndex[b];
+        ok = brick == OUTSIDE || brick == INSIDE ||
+             (brick >= 0 && size_t(brick) + brickValues <= m_values.size());
+    }
+
+    if(!ok)
+    {
+        m_brickIndex.clear();
+        m_values.clear();
+        return false;
+    }
+
+    m_min = QVector3D(header[0], header[1], header[2]);
+    m_max = QVector3D(header[3], header[4], header[5]);
+    m_cellSize = header[6];
+    m_band = header[7];
+    return true;
+}
+
+// trilinear in the grid, outside it the distance to the grid is added
+float SignedDistanceField::distance(const QVector3D &_p) const
+{
+    if(empty())
+        return std::numeric_limits<float>::max();
+
+    QVector3D clamped(std::max(m_min.x(), std::min(m_max.x(), _p.x())),
+                      std::max(m_min.y(), std::min(m_max.y(), _p.y())),
+                      std::max(m_min.z(), std::min(m_max.z(), _p.z())));
+    float outside = (_p - clamped).length();
+
+    QVector3D g = (clamped - m_min) / m_cellSize;
+    int c[3];
+    float f[3];
+    for(int a=0; a < 3; a++)
+    {
+        c[a] = std::max(0, std::min(m_dims[a] - 2, int(std::floor(g[a]))));
+        f[a] = g[a] - c[a];
+    }
+
+    float d00 = node(c[0], c[1],   c[2]  ) * (1 - f[0]) + node(c[0]+1, c[1],   c[2]  ) * f[0];
+    float d10 = node(c[0], c[1]+1, c[2]  ) * (1 - f[0]) + node(c[0]+1, c[1]+1, c[2]  ) * f[0];
+    float d01 = node(c[0], c[1],   c[2]+1) * (1 - f[0]) + node(c[0]+1, c[1],   c[2]+1) * f[0];
+    float d11 = node(c[0], c[1]+1, c[2]+1) * (1 - f[0]) + node(c[0]+1, c[1]+1, c[2]+1) * f[0];
+    float d0 = d00 * (1 - f[1]) + d10 * f[1];
+    float d1 = d01 * (1 - f[1]) + d11 * f[1];
+    return d0 * (1 - f[2]) + d1 * f[2] + outside;
+}
+
+QVector3D SignedDistanceField::gradient(const QVector3D &_p) const
+{
+    float h = 0.5f * m_cellSize;
+    QVector3D dx(h, 0, 0), dy(0, h, 0), dz(0, 0, h);
+    QVector3D g(distance(_p + dx) - distance(_p - dx),
+                distance(_p + dy) - distance(_p - dy),
+                distance(_p + dz) - distance(_p - dz));
+    return g.normalized();
+}
+
+void SignedDistanceField::sampleInterior(float _spacing, std::vector<QVector3D> &_points, std::vector<QVector3D> &_gradients) const
+{
+    _points.clear();
+    _gradients.clear();
+    if(empty() || _spacing <= 0)
+        return;
+
+    // as many points as fit the mesh bounds, centered in them
+    float margin = m_band + m_cellSize;
+    QVector3D center = 0.5f * (m_min + m_max);
+    int count[3];
+    for(int a=0; a < 3; a++)
+        count[a] = std::max(1, int((m_max[a] - m_min[a] - 2 * margin) / _spacing + 1e-4f));
+    QVector3D first = center - 0.5f * _spacing * QVector3D(count[0] - 1, count[1] - 1, count[2] - 1);
+
+    for(int k=0; k < count[2]; k++)
+    for(int j=0; j < count[1]; j++)
+    for(int i=0; i < count[0]; i++)
+    {
+        QVector3D p = first + _spacing * QVector3D(i, j, k);
+        float d = distance(p);
+        if(d >= 0)
+            continue;
+        _points.push_back(p);
+        _gradients.push_back(-d * gradient(p));
+    }
+}
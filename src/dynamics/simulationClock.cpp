@@ -0,0 +1,55 @@
+#include "dynamics/simulationClock.h"
+
+#include <algorithm>
+
+SimulationClock::SimulationClock(float _stepSize, int _maxSteps)
+    : m_stepSize(_stepSize),
+      m_maxSteps(_maxSteps)
+{
+
+}
+
+void SimulationClock::setStepSize(float _stepSize)
+{
+    m_stepSize = _stepSize;
+}
+
+void SimulationClock::setMaxSteps(int _maxSteps)
+{
+    m_maxSteps = std::max(1, _maxSteps);
+}
+
+void SimulationClock::reset()
+{
+    m_accumulator = 0;
+    m_dropped = 0;
+}
+
+int SimulationClock::advance(double _seconds)
+{
+    if(m_stepSize <= 0)
+        return 0;
+
+    m_accumulator += std::max(0.0, _seconds);
+    int steps = int(m_accumulator / m_stepSize);
+    if(steps > m_maxSteps)
+    {
+        m_dropped += (steps - m_maxSteps) * double(m_stepSize);
+        m_accumulator -= (steps - m_maxSteps) * double(m_stepSize);
+        steps = m_maxSteps;
+    }
+    m_accumulator -= steps * double(m_stepSize);
+    return steps;
+}
+
+float SimulationClock::alpha() const
+{
+    if(m_stepSize <= 0)
+        return 1;
+    return float(std::min(1.0, m_accumulator / m_stepSize));
+}
+
+double SimulationClock::timeToNextStep() const
+{
+    return std::max(0.0, m_stepSize - m_accumulator);
+}
@@ -0,0 +1,159 @@
+#include "dynamics/simulationIslands.h"
+
+#include <algorithm>
+#include <climits>
+
+SimulationIslands::SimulationIslands()
+{
+
+}
+
+void SimulationIslands::resize(int _numParticles)
+{
+    m_parent.resize(_numParticles);
+    m_island.resize(_numParticles, -1);
+    m_restFrames.resize(_numParticles, 0);
+    m_islandRest.resize(_numParticles);
+}
+
+void SimulationIslands::beginFrame()
+{
+    for(int i=0; i < int(m_parent.size()); i++)
+    {
+        m_parent[i] = i;
+    }
+}
+
+// path halving, the smaller root wins so the labels don't depend on the
+// order of the edges
+int SimulationIslands::find(int _idx)
+{
+    while(m_parent[_idx] != _idx)
+    {
+        m_parent[_idx] = m_parent[m_parent[_idx]];
+        _idx = m_parent[_idx];
+    }
+    return _idx;
+}
+
+void SimulationIslands::connect(int _a, int _b)
+{
+    bool sleepA = asleep(_a);
+    bool sleepB = asleep(_b);
+    if(sleepA || sleepB)
+    {
+        if(!sleepA)
+            wake(_b);
+        else if(!sleepB)
+            wake(_a);
+        return;
+    }
+
+    int a = find(_a);
+    int b = find(_b);
+    if(a < b)
+        m_parent[b] = a;
+    else if(b < a)
+        m_parent[a] = b;
+}
+
+void SimulationIslands::connect(const int *_indices, int _count)
+{
+    for(int i=1; i < _count; i++)
+    {
+        connect(_indices[0], _indices[i]);
+    }
+}
+
+// counted as not resting this frame
+void SimulationIslands::keepAwake(int _idx)
+{
+    if(asleep(_idx))
+        wake(_idx);
+    m_restFrames[_idx] = -1;
+}
+
+bool SimulationIslands::sleep(ParticleData &_particles, float _velocity, int _frames)
+{
+    int n = int(m_parent.size());
+    float velocity2 = _velocity * _velocity;
+
+    for(int i=0; i < n; i++)
+    {
+        if(asleep(i))
+            continue;
+
+        bool resting = m_restFrames[i] >= 0 && _particles.v[i].lengthSquared() <= velocity2;
+        m_restFrames[i] = resting ? m_restFrames[i] + 1 : 0;
+        m_islandRest[i] = INT_MAX;
+    }
+
+    for(int i=0; i < n; i++)
+    {
+        if(asleep(i))
+            continue;
+
+        int root = find(i);
+        m_islandRest[root] = std::min(m_islandRest[root], m_restFrames[i]);
+    }
+
+    // the roots are awake particles, so they never clash with the label of
+    // an island that is already asleep
+    bool changed = false;
+    for(int i=0; i < n; i++)
+    {
+        if(asleep(i))
+            continue;
+
+        int root = find(i);
+        if(m_islandRest[root] < _frames)
+            continue;
+
+        m_island[i] = root;
+        _particles.v[i] = QVector3D(0, 0, 0);
+        _particles.p[i] = _particles.x[i];
+        m_numAsleep++;
+        changed = true;
+    }
+    return changed;
+}
+
+void SimulationIslands::wake(int _idx)
+{
+    if(asleep(_idx))
+        m_wake.push_back(m_island[_idx]);
+}
+
+bool SimulationIslands::wakeQueued(ParticleData &_particles)
+{
+    if(m_wake.empty())
+        return false;
+
+    std::sort(m_wake.begin(), m_wake.end());
+    m_wake.erase(std::unique(m_wake.begin(), m_wake.end()), m_wake.end());
+
+    for(int i=0; i < int(m_island.size()); i++)
+    {
+        if(!asleep(i) || !std::binary_search(m_wake.begin(), m_wake.end(), m_island[i]))
+            continue;
+
+        m_island[i] = -1;
+        m_restFrames[i] = 0;
+        _particles.p[i] = _particles.x[i];
+        m_numAsleep--;
+    }
+
+    m_wake.clear();
+    return true;
+}
+
+void SimulationIslands::wakeAll()
+{
+    for(int i=0; i < int(m_island.size()); i++)
+    {
+        m_island[i] = -1;
+        m_restFrames[i] = 0;
+    }
+    m_wake.clear();
+    m_numAsleep = 0;
+}
@@ -11,7 +11,7 @@ const QMatrix4x4 SingleParticle::getTransfrom()
     QMatrix4x4 t;
     t.setToIdentity();
 
-    t.translate(m_particle->x);
+    t.translate(m_particle->renderPosition());
     t.rotate(0, QVector3D(0,1,0));
     t.scale((2 * m_radius) * QVector3D(1,1,1));
 
@@ -20,7 +20,12 @@ const QMatrix4x4 SingleParticle::getTransfrom()
 
 const QVector3D SingleParticle::getTranslation()
 {
-    return m_particle->x;
+    return m_particle->renderPosition();
+}
+
+bool SingleParticle::presented()
+{
+    return m_particle->presented();
 }
 
 void SingleParticle::pinToPosition(const QVector3D &_pos)
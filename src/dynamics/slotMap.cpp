@@ -0,0 +1,79 @@
+#include "dynamics/slotMap.h"
+
+SlotIndex::SlotIndex()
+{
+}
+
+SlotHandle SlotIndex::insert()
+{
+    uint32_t slot;
+    if(m_freeSlot >= 0)
+    {
+        slot = uint32_t(m_freeSlot);
+        m_freeSlot = m_slots[slot].dense;
+    }
+    else
+    {
+        slot = uint32_t(m_slots.size());
+        m_slots.push_back(Slot());
+    }
+
+    m_slots[slot].dense = int(m_denseSlot.size());
+    m_denseSlot.push_back(slot);
+
+    SlotHandle handle;
+    handle.index = slot;
+    handle.generation = m_slots[slot].generation;
+    return handle;
+}
+
+int SlotIndex::remove(SlotHandle _handle)
+{
+    int hole = find(_handle);
+    if(hole < 0)
+        return -1;
+
+    // the last entry takes over the hole
+    uint32_t last = m_denseSlot.back();
+    m_denseSlot[hole] = last;
+    m_slots[last].dense = hole;
+    m_denseSlot.pop_back();
+
+    Slot &slot = m_slots[_handle.index];
+    slot.generation++;
+    slot.dense = m_freeSlot;
+    m_freeSlot = int(_handle.index);
+    return hole;
+}
+
+int SlotIndex::find(SlotHandle _handle) const
+{
+    if(_handle.index >= m_slots.size())
+        return -1;
+
+    const Slot &slot = m_slots[_handle.index];
+    if(slot.generation != _handle.generation)
+        return -1;
+    return slot.dense;
+}
+
+SlotHandle SlotIndex::handle(int _dense) const
+{
+    SlotHandle handle;
+    handle.index = m_denseSlot[_dense];
+    handle.generation = m_slots[handle.index].generation;
+    return handle;
+}
+
+// generations survive a clear, old handles stay stale
+void SlotIndex::clear()
+{
+    m_denseSlot.clear();
+    m_freeSlot = -1;
+    for(int i = int(m_slots.size()) - 1; i >= 0; i--)
+    {
+        m_slots[i].generation++;
+        m_slots[i].dense = m_freeSlot;
+        m_freeSlot = i;
+    }
+}
@@ -1,4 +1,5 @@
 #include "include/dynamics/softBody.h"
+#include "model.h"
 
 SoftBody::SoftBody()
 {
@@ -17,52 +18,21 @@ void SoftBody::addParticle(const QVector3D &_localPos, const ParticleWeakPtr _pa
     m_particles.push_back(_particle);
 }
 
-std::vector<std::set<int> > SoftBody::createConstraintNetwork()
+MeshEdges SoftBody::createConstraintNetwork()
 {
-    std::vector< std::set<int> > constraintIdxPairs;
     ShapePtr shape = getModel()->getShape(0);
-    std:: vector<unsigned int> vertIndices = shape->getIndices();
-    int verticesSize = shape->getVertices().size()-1;
-
-    for(int i=2; i < vertIndices.size(); i+=3 )
-    {
-        int vertIdxA = vertIndices[i-2];
-        int vertIdxB = vertIndices[i-1];
-        int vertIdxC = vertIndices[i];
-
-        int poitIdxA = findKbyValueElement(shape->getVertsMap(), vertIdxA);
-        int poitIdxB = findKbyValueElement(shape->getVertsMap(), vertIdxB);
-        int poitIdxC = findKbyValueElement(shape->getVertsMap(), vertIdxC);
-
-        std::set<int> edgeAB = {poitIdxA, poitIdxB};
-        std::set<int> edgeBA = {poitIdxB, poitIdxC};
-        std::set<int> edgeCA = {poitIdxC, poitIdxA};
-
-        std::vector<std::set<int>> edges = {edgeAB, edgeBA, edgeCA};
-        for(auto edge : edges)
-        {
-            if(!hasPair(constraintIdxPairs, edge))
-                constraintIdxPairs.push_back(edge);
-        }
-    }
-    return constraintIdxPairs;
+    MeshEdges edges;
+    edges.build(shape->getVertsMap(), shape->getIndices());
+    return edges;
 }
 
+// its particles share the body id, an empty mask filters every pair of them
 void SoftBody::turnOffSelfCollision()
 {
     for(auto p : m_particles)
     {
         if(auto particle = p.lock())
-        {
-            for_each(m_particles.begin(), m_particles.end(), [&particle](ParticleWeakPtr pNeighbour)
-            {
-                if(particle != pNeighbour.lock())
-                {
-                    std::shared_ptr<Particle> sharedNeighbour = pNeighbour.lock();
-                    particle->m_NonCollisionParticles.push_back(sharedNeighbour);
-                }
-            });
-        }
+            particle->setCollisionGroup(1, 0);
     }
 }
 
@@ -73,7 +43,11 @@ void SoftBody::updateModelBuffers()
         ShapePtr shape = m_model->getShape(i);
         for(int i=0; i < shape->getVertsMap().size();  i++)
         {
-            QVector3D position = m_particles[i].lock()->getTranslation();
+            // left where the model put it until the particle is presented
+            ParticlePtr particle = m_particles[i].lock();
+            if(!particle->presented())
+                continue;
+            QVector3D position = particle->getTranslation();
             for(auto vertIdx : shape->getVertsMap()[i])
             {
                 shape->setVertexPositionAtIndex(vertIdx, position);
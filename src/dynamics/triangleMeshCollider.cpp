@@ -0,0 +1,280 @@
+#include "dynamics/triangleMeshCollider.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+const float infinity = std::numeric_limits<float>::max();
+
+struct Bin
+{
+    QVector3D min = QVector3D(infinity, infinity, infinity);
+    QVector3D max = QVector3D(-infinity, -infinity, -infinity);
+    int count = 0;
+
+    void grow(const QVector3D &_min, const QVector3D &_max)
+    {
+        min = QVector3D(std::min(min.x(), _min.x()), std::min(min.y(), _min.y()), std::min(min.z(), _min.z()));
+        max = QVector3D(std::max(max.x(), _max.x()), std::max(max.y(), _max.y()), std::max(max.z(), _max.z()));
+    }
+};
+
+float area(const QVector3D &_min, const QVector3D &_max)
+{
+    QVector3D d = _max - _min;
+    if(d.x() < 0 || d.y() < 0 || d.z() < 0)
+        return 0;
+    return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
+void triangleBounds(const TriangleMeshCollider::Triangle &_t, QVector3D &_min, QVector3D &_max)
+{
+    _min = QVector3D(std::min({_t.a.x(), _t.b.x(), _t.c.x()}),
+                     std::min({_t.a.y(), _t.b.y(), _t.c.y()}),
+                     std::min({_t.a.z(), _t.b.z(), _t.c.z()}));
+    _max = QVector3D(std::max({_t.a.x(), _t.b.x(), _t.c.x()}),
+                     std::max({_t.a.y(), _t.b.y(), _t.c.y()}),
+                     std::max({_t.a.z(), _t.b.z(), _t.c.z()}));
+}
+}
+
+TriangleMeshCollider::TriangleMeshCollider()
+{
+}
+
+void TriangleMeshCollider::add(const std::vector<QVector3D> &_vertices, const std::vector<unsigned int> &_indices,
+                               uint32_t _layer, uint32_t _layerMask)
+{
+    for(size_t i=2; i < _indices.size(); i+=3)
+    {
+        Triangle t;
+        t.a = _vertices[_indices[i-2]];
+        t.b = _vertices[_indices[i-1]];
+        t.c = _vertices[_indices[i]];
+        t.n = QVector3D::crossProduct(t.b - t.a, t.c - t.a);
+        // degenerate triangles have no side to push particles to
+        if(t.n.length() < 1e-12f)
+            continue;
+        t.n.normalize();
+        t.layer = _layer;
+        t.layerMask = _layerMask;
+        m_triangles.push_back(t);
+    }
+    m_dirty = true;
+}
+
+void TriangleMeshCollider::clear()
+{
+    m_triangles.clear();
+    m_centroids.clear();
+    m_nodes.clear();
+    m_dirty = false;
+}
+
+void TriangleMeshCollider::build()
+{
+    if(!m_dirty)
+        return;
+    m_dirty = false;
+
+    m_nodes.clear();
+    if(m_triangles.empty())
+        return;
+
+    m_centroids.resize(m_triangles.size());
+    for(size_t i=0; i < m_triangles.size(); i++)
+    {
+        const Triangle &t = m_triangles[i];
+        m_centroids[i] = (t.a + t.b + t.c) / 3.0f;
+    }
+
+    m_nodes.reserve(2 * m_triangles.size() / maxLeafSize + 1);
+    m_nodes.push_back(Node());
+    buildNode(0, 0, int(m_triangles.size()), 0);
+}
+
+void TriangleMeshCollider::bounds(int _first, int _count, QVector3D &_min, QVector3D &_max,
+                                  QVector3D &_centroidMin, QVector3D &_centroidMax) const
+{
+    Bin all, centroids;
+    for(int i = _first; i < _first + _count; i++)
+    {
+        QVector3D min, max;
+        triangleBounds(m_triangles[i], min, max);
+        all.grow(min, max);
+        centroids.grow(m_centroids[i], m_centroids[i]);
+    }
+    _min = all.min;
+    _max = all.max;
+    _centroidMin = centroids.min;
+    _centroidMax = centroids.max;
+}
+
+// the cost of a split is the area weighted triangle count of its halves,
+// traversing a node costs as much as testing one triangle
+void TriangleMeshCollider::buildNode(int _node, int _first, int _count, int _depth)
+{
+    QVector3D min, max, centroidMin, centroidMax;
+    bounds(_first, _count, min, max, centroidMin, centroidMax);
+    m_nodes[_node].min = min;
+    m_nodes[_node].max = max;
+    m_nodes[_node].first = _first;
+    m_nodes[_node].count = _count;
+
+    if(_count <= 2 || _depth >= maxDepth)
+        return;
+
+    float bestCost = infinity;
+    int bestAxis = -1;
+    int bestSplit = 0;
+    QVector3D extent = centroidMax - centroidMin;
+    for(int axis=0; axis < 3; axis++)
+    {
+        if(extent[axis] <= 0)
+            continue;
+
+        Bin bins[numBins];
+        float scale = numBins / extent[axis];
+        for(int i = _first; i < _first + _count; i++)
+        {
+            int b = std::min(numBins - 1, int((m_centroids[i][axis] - centroidMin[axis]) * scale));
+            QVector3D tMin, tMax;
+            triangleBounds(m_triangles[i], tMin, tMax);
+            bins[b].grow(tMin, tMax);
+            bins[b].count++;
+        }
+
+        // areas and counts left of every split, then swept from the right
+        float leftArea[numBins - 1];
+        int leftCount[numBins - 1];
+        Bin left;
+        int n = 0;
+        for(int b=0; b < numBins - 1; b++)
+        {
+            left.grow(bins[b].min, bins[b].max);
+            n += bins[b].count;
+            leftArea[b] = area(left.min, left.max);
+            leftCount[b] = n;
+        }
+
+        Bin right;
+        n = 0;
+        for(int b = numBins - 1; b > 0; b--)
+        {
+            right.grow(bins[b].min, bins[b].max);
+            n += bins[b].count;
+            float cost = leftArea[b - 1] * leftCount[b - 1] + area(right.min, right.max) * n;
+            if(leftCount[b - 1] && n && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    float nodeArea = area(min, max);
+    bool worthIt = bestAxis >= 0 && nodeArea + bestCost < nodeArea * _count;
+    if(!worthIt && _count <= maxLeafSize)
+        return;
+
+    int mid;
+    if(bestAxis >= 0)
+    {
+        float scale = numBins / extent[bestAxis];
+        int i = _first;
+        int j = _first + _count - 1;
+        while(i <= j)
+        {
+            int b = std::min(numBins - 1, int((m_centroids[i][bestAxis] - centroidMin[bestAxis]) * scale));
+            if(b < bestSplit)
+            {
+                i++;
+            }
+            else
+            {
+                std::swap(m_triangles[i], m_triangles[j]);
+                std::swap(m_centroids[i], m_centroids[j]);
+                j--;
+            }
+        }
+        mid = i;
+    }
+    else
+    {
+        // all centroids in one point, any halving will do
+        mid = _first + _count / 2;
+    }
+
+    int left = int(m_nodes.size());
+    m_nodes.push_back(Node());
+    buildNode(left, _first, mid - _first, _depth + 1);
+
+    int right = int(m_nodes.size());
+    m_nodes.push_back(Node());
+    buildNode(right, mid, _first + _count - mid, _depth + 1);
+
+    m_nodes[_node].first = right;
+    m_nodes[_node].count = 0;
+}
+
+QVector3D TriangleMeshCollider::closestPoint(const QVector3D &_p, const Triangle &_t, bool &_face)
+{
+    Feature feature;
+    QVector3D q = closestPoint(_p, _t.a, _t.b, _t.c, feature);
+    _face = feature == FACE;
+    return q;
+}
+
+// Ericson, Real-Time Collision Detection 5.1.5, by the Voronoi regions of
+// the corners and edges
+QVector3D TriangleMeshCollider::closestPoint(const QVector3D &_p, const QVector3D &_a, const QVector3D &_b, const QVector3D &_c,
+                                             Feature &_feature)
+{
+    const QVector3D &a = _a;
+    const QVector3D &b = _b;
+    const QVector3D &c = _c;
+
+    QVector3D ab = b - a;
+    QVector3D ac = c - a;
+    QVector3D ap = _p - a;
+    float d1 = QVector3D::dotProduct(ab, ap);
+    float d2 = QVector3D::dotProduct(ac, ap);
+    _feature = VERTEX_A;
+    if(d1 <= 0 && d2 <= 0)
+        return a;
+
+    QVector3D bp = _p - b;
+    float d3 = QVector3D::dotProduct(ab, bp);
+    float d4 = QVector3D::dotProduct(ac, bp);
+    _feature = VERTEX_B;
+    if(d3 >= 0 && d4 <= d3)
+        return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    _feature = EDGE_AB;
+    if(vc <= 0 && d1 >= 0 && d3 <= 0)
+        return a + d1 / (d1 - d3) * ab;
+
+    QVector3D cp = _p - c;
+    float d5 = QVector3D::dotProduct(ab, cp);
+    float d6 = QVector3D::dotProduct(ac, cp);
+    _feature = VERTEX_C;
+    if(d6 >= 0 && d5 <= d6)
+        return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    _feature = EDGE_CA;
+    if(vb <= 0 && d2 >= 0 && d6 <= 0)
+        return a + d2 / (d2 - d6) * ac;
+
+    float va = d3 * d6 - d5 * d4;
+    _feature = EDGE_BC;
+    if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+
+    _feature = FACE;
+    float denom = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
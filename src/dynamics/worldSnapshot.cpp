@@ -0,0 +1,24 @@
+#include "dynamics/worldSnapshot.h"
+
+SnapshotBuffer::SnapshotBuffer()
+    : m_middle(1)
+{
+
+}
+
+// release makes the filled back buffer visible to the acquire of the reader
+void SnapshotBuffer::publish()
+{
+    int previous = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel);
+    m_back = previous & ~fresh;
+}
+
+bool SnapshotBuffer::acquire()
+{
+    if(!(m_middle.load(std::memory_order_relaxed) & fresh))
+        return false;
+
+    int previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+    m_front = previous & ~fresh;
+    return true;
+}
@@ -1,21 +1,24 @@
-#include <boost/functional/hash.hpp>
-#include <boost/math/distributions.hpp>
 #include <math.h>
 
+#include <omp.h>
+
 #include "hashgrid.h"
 
 #include <QDebug>
 
+// below this many particles a single thread builds the grid
+static const int parallelBuildThreshold = 8192;
+
 HashGrid::HashGrid(float _cellSize)
 {
     qDebug("HashGrid Particle tmpl ctor 2");
-//    auto a = boost::math::iround<float>(14.494);
-
 }
 
 void HashGrid::clear()
 {
-    m_buckets.clear();
+    m_particleHash.clear();
+    m_sortedParticles.clear();
+    std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
 }
 
 void HashGrid::setGridSize(float _size)
@@ -28,232 +31,117 @@ float HashGrid::getGridSize()
     return cellSize;
 }
 
-bool HashGrid::insert(size_t _hashV, ParticlePtr _p)
+void HashGrid::build(const ParticleData &_particles)
 {
+    int numParticles = int(_particles.size());
 
-    bool CellExists = false;
-    if(cellExists(_hashV))
-    {
-        CellExists = true;
-    }
-    m_buckets[_hashV].push_back(_p);
-    return CellExists;
+    // power of two table with at least two buckets per particle
+    size_t tableSize = 64;
+    while(tableSize < size_t(2 * numParticles))
+        tableSize <<= 1;
+    m_tableMask = tableSize - 1;
+    int numBuckets = int(tableSize);
 
-}
+    int numThreads = numParticles < parallelBuildThreshold ? 1 : omp_get_max_threads();
 
-bool HashGrid::cellExists(size_t _hashV)
-{
-    bool CellExists = false;
-    std::unordered_map< size_t , std::list< ParticlePtr >>::const_iterator itr = m_buckets.find(_hashV);
-    if ( itr == m_buckets.end())
-    {
-        CellExists = false;
-    }
-    else
+    m_particleHash.resize(numParticles);
+    m_sortedParticles.resize(numParticles);
+    m_cellStart.resize(tableSize + 1);
+    m_cellCount.resize(tableSize);
+    m_blockSum.resize(numThreads + 1);
+
+    int *count = m_cellCount.data();
+    int *start = m_cellStart.data();
+    int *sorted = m_sortedParticles.data();
+    int *blockSum = m_blockSum.data();
+
+    #pragma omp parallel num_threads(numThreads)
     {
-        CellExists = true;
+        #pragma omp for
+        for(int c=0; c < numBuckets; c++)
+            count[c] = 0;
+
+        #pragma omp for
+        for(int i=0; i < numParticles; i++)
+        {
+            const QVector3D &x = _particles.x[i];
+            int hash = int(hashFunction(pointToCell(x.x(), x.y(), x.z())));
+            m_particleHash[i] = hash;
+            #pragma omp atomic
+            count[hash]++;
+        }
+
+        // prefix sum, every thread over its own block of buckets
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        int begin = int(tableSize * t / nt);
+        int end = int(tableSize * (t + 1) / nt);
+        int sum = 0;
+        for(int c = begin; c < end; c++)
+            sum += count[c];
+        blockSum[t + 1] = sum;
+
+        #pragma omp barrier
+        #pragma omp single
+        {
+            blockSum[0] = 0;
+            for(int b=1; b <= nt; b++)
+                blockSum[b] += blockSum[b - 1];
+        }
+
+        sum = blockSum[t];
+        for(int c = begin; c < end; c++)
+        {
+            int n = count[c];
+            start[c] = sum;
+            count[c] = sum;
+            sum += n;
+        }
+        #pragma omp barrier
+
+        #pragma omp for
+        for(int i=0; i < numParticles; i++)
+        {
+            int slot;
+            #pragma omp atomic capture
+            slot = count[m_particleHash[i]]++;
+            sorted[slot] = i;
+        }
+
+        // threads scatter in any order, buckets are short so they are put
+        // back in index order one by one. That keeps the pairs found the
+        // same for any thread count.
+        #pragma omp for
+        for(int c=0; c < numBuckets; c++)
+        {
+            int first = start[c];
+            int last = count[c];
+            for(int s = first + 1; s < last; s++)
+            {
+                int p = sorted[s];
+                int q = s;
+                for(; q > first && sorted[q - 1] > p; q--)
+                    sorted[q] = sorted[q - 1];
+                sorted[q] = p;
+            }
+        }
     }
-    return CellExists;
+    start[tableSize] = numParticles;
 }
 
 size_t HashGrid::hashFunction(int3 _cell)
 {
-        // seed prime number
-        size_t hash = 85523717;
-        boost::hash_combine(hash, _cell.i);
-        boost::hash_combine(hash, _cell.j);
-        boost::hash_combine(hash, _cell.k);
-        return hash;
-}
-
-size_t HashGrid::hashFunciton(float _i, float _j, float _k)
-{
-    size_t hash = 85523717;
-    boost::hash_combine(hash, _i);
-    boost::hash_combine(hash, _j);
-    boost::hash_combine(hash, _k);
-    return hash;
+    // large primes, see Teschner et al. "Optimized Spatial Hashing"
+    size_t hash = (size_t(_cell.i) * 73856093) ^ (size_t(_cell.j) * 19349663) ^ (size_t(_cell.k) * 83492791);
+    return hash & m_tableMask;
 }
 
 int3 HashGrid::pointToCell(float _x, float _y, float _z)
 {
     int3 cell;
     // rounding to full integer - coversion
-    // optionally use: auto a = boost::math::iround<float>(_x);
-//    cell.i = int(_x * (1 / cellSize));
-//    cell.j = int(_y * (1 / cellSize));
-//    cell.k = int(_z * (1 / cellSize));
     cell.i = int(_x * ( cellSize));
     cell.j = int(_y * ( cellSize));
     cell.k = int(_z * ( cellSize));
-//    cell.i = int((_x + 0.1) * (1 / cellSize));
-//    cell.j = int((_y + 0.1) * (1 / cellSize));
-//    cell.k = int((_z + 0.1) * (1 / cellSize));
-//    mlog<<cell.i<<" , "<<cell.j<<" , "<<cell.k<<" cellSize: "<<cellSize<<" - "<<_x<<" , "<<_y<<" , "<<_z;
     return cell;
 }
-
-std::list<ParticlePtr> HashGrid:: query(size_t _hash)
-{
-    std::list<ParticlePtr> cellList;
-//    if(!cellExists(_hash))
-//    {
-//        return cellList;
-//    }
-//    else
-    {
-//        auto test = m_buckets[_hash];
-        return m_buckets[_hash];
-    }
-}
-
-std::list<ParticlePtr> HashGrid::cellNeighbours(int3 _cell)
-{
-    std::list<ParticlePtr> neighbourParticles_empty;
-
-    std::list<ParticlePtr> neighbourParticles;
-//    std::list<int3> neighbourCells;
-//    size_t middleHash = hashFunction(_cell);
-
-    int level = 1;
-//    int length = level + 2;
-//    int size = std::pow(length, 3);
-
-
-    for(int y = -1 ; y <= level ; y++)
-    {
-        for(int x = -1 ; x <= level ; x++)
-        {
-            for(int z = -1 ; z <= level ; z++)
-            {
-                int3 nCell;
-                nCell.i = _cell.i + x;
-                nCell.j = _cell.j + y;
-                nCell.k = _cell.k + z;
-
-//                neighbourCells.push_back(nCell);
-
-                // query for std::list<ParticlePtr>
-                // and if possible merge
-                size_t hash = hashFunction(nCell);
-//                if(hash == middleHash) continue;
-
-                if(cellExists(hash))
-                {
-//                    qDebug()<<"Found a hash: "<<x<<y<<z;
-//                    std::list<ParticlePtr> currentCellList = query(hash);
-//                    std::list<ParticlePtr> currentCellList = m_buckets[hash];
-                    std::unordered_map< size_t , std::list< ParticlePtr >>::iterator test = m_buckets.find(hash);
-//                    tmpList = m_buckets.find(hash);
-                    for(auto n : test->second)
-                    {
-                        float p = n->position().x();
-//                        neighbourParticles_empty.push_back(n);
-                    }
-//                    std::list<ParticlePtr>::const_iterator itr = neighbourParticles.end();
-//                    std::list<ParticlePtr>::const_iterator itrNCellStart = currentCellList.begin();
-//                    std::list<ParticlePtr>::const_iterator itrNCellEnd = currentCellList.end();
-//                    neighbourParticles.insert(itr, itrNCellStart, itrNCellEnd);
-                };
-//                qDebug()<<"N: "<<n;
-            }
-        }
-    }
-
-//    qDebug()<<&neighbourParticles;
-//    return neighbourParticles;
-    return neighbourParticles_empty;
-}
-
-
-//int HashGrid::cellNeighboursFunc(int3 _cell, void *func)
-//{
-//    return 1;
-//    std::list<ParticlePtr> neighbourParticles_empty;
-
-//    std::list<ParticlePtr> neighbourParticles;
-////    std::list<int3> neighbourCells;
-////    size_t middleHash = hashFunction(_cell);
-
-//    int level = 1;
-////    int length = level + 2;
-////    int size = std::pow(length, 3);
-//    int n = 0;
-
-//    for(int y = -1 ; y <= level ; y++)
-//    {
-//        for(int x = -1 ; x <= level ; x++)
-//        {
-//            for(int z = -1 ; z <= level ; z++)
-//            {
-//                int3 nCell;
-//                nCell.i = _cell.i + x;
-//                nCell.j = _cell.j + y;
-//                nCell.k = _cell.k + z;
-
-////                neighbourCells.push_back(nCell);
-
-//                // query for std::list<ParticlePtr>
-//                // and if possible merge
-//                size_t hash = hashFunction(nCell);
-////                if(hash == middleHash) continue;
-
-//                if(cellExists(hash))
-//                {
-////                    qDebug()<<"Found a hash: "<<x<<y<<z;
-////                    std::list<ParticlePtr> currentCellList = query(hash);
-////                    std::list<ParticlePtr> currentCellList = m_buckets[hash];
-//                    std::unordered_map< size_t , std::list< ParticlePtr >>::iterator test = m_buckets.find(hash);
-////                    tmpList = m_buckets.find(hash);
-//                    for(auto n : test->second)
-//                    {
-//                        float p = n->position().x();
-//                    }
-////                    std::list<ParticlePtr>::const_iterator itr = neighbourParticles.end();
-////                    std::list<ParticlePtr>::const_iterator itrNCellStart = currentCellList.begin();
-////                    std::list<ParticlePtr>::const_iterator itrNCellEnd = currentCellList.end();
-////                    neighbourParticles.insert(itr, itrNCellStart, itrNCellEnd);
-//                };
-////                qDebug()<<"N: "<<n;
-//                n++;
-//            }
-//        }
-//    }
-
-////    qDebug()<<&neighbourParticles;
-////    return neighbourParticles;
-//    return neighbourParticles_empty;
-//}
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
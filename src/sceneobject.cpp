@@ -70,8 +70,12 @@ void SceneObject::bind()
     pShape->bind();
 }
 
+// particles spawned after the presented snapshot have no position yet
 void SceneObject::draw()
 {
+    if(isDynamic() && !pDynamicObject->presented())
+        return;
+
     if(pModel != nullptr)
     {
         pModel->draw();
@@ -105,6 +109,9 @@ void SceneObject::update()
 {
     if(isDynamic())
     {
+        if(!pDynamicObject->presented())
+            return;
+
         m_ModelMatrix = pDynamicObject->getTransfrom();
         setTranslation(pDynamicObject->getTranslation());
 